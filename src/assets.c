@@ -0,0 +1,226 @@
+#include "assets.h"
+#include "thd.h"
+#include "profile.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+//a cached image is this header followed by width*height rgba pixels. the source's size and
+//modification time decide whether the cache is still good.
+#define CACHE_MAGIC "t3drgba1"
+
+typedef struct {
+	char magic[8];
+	uint64_t source_size;
+	int64_t source_mtime;
+	int32_t width, height;
+	int32_t flip_vertically;
+	int32_t pad[3];
+} cache_header_t;
+_Static_assert(sizeof(cache_header_t) % 16 == 0,"pixels after the header stay aligned");
+
+static struct {
+	char cache_dir[256]; //fixed while the loader runs, empty for no cache
+
+	//guarded by mutex
+	thd_thread thread;
+	thd_mutex mutex;
+	thd_condition wake, finished;
+	asset_t *head, *tail; //requests
+	bool quit;
+
+	bool open;
+} loader;
+
+static void cache_path(asset_t *a, char *path, int size){
+	int n = snprintf(path,size,"%s/",loader.cache_dir);
+	for (char *c = a->path; *c && n < size-16; c++){
+		path[n++] = *c == '/' || *c == '\\' || *c == ':' ? '_' : *c;
+	}
+	snprintf(path+n,size-n,"%s.rgba",a->flip_vertically ? ".flip" : "");
+}
+
+static bool read_image(asset_t *a){
+	struct stat st;
+	if (stat(a->path,&st)){
+		return false;
+	}
+	char path[1024];
+	if (loader.cache_dir[0]){
+		cache_path(a,path,sizeof(path));
+		if (map_file(&a->map,path)){
+			cache_header_t *h = (cache_header_t *)a->map.data;
+			if (a->map.size >= sizeof(*h) && !memcmp(h->magic,CACHE_MAGIC,sizeof(h->magic))
+				&& h->source_size == (uint64_t)st.st_size && h->source_mtime == (int64_t)st.st_mtime
+				&& h->flip_vertically == a->flip_vertically && h->width > 0 && h->height > 0
+				&& a->map.size == sizeof(*h) + (size_t)h->width * h->height * sizeof(*a->pixels)){
+				a->width = h->width;
+				a->height = h->height;
+				a->pixels = (uint32_t *)(h+1);
+				a->cached = true;
+				return true;
+			}
+			unmap_file(&a->map);
+		}
+	}
+
+	mapped_file_t source;
+	if (!map_file(&source,a->path)){
+		return false;
+	}
+	uint64_t t = profile_begin();
+	a->pixels = decode_png(source.data,source.size,a->flip_vertically,&a->width,&a->height);
+	profile_end("decode png",t);
+	unmap_file(&source);
+	if (!a->pixels){
+		return false;
+	}
+
+	//written beside the final name and renamed over it, so a reader never maps half a file
+	if (loader.cache_dir[0]){
+		cache_header_t h = {
+			.source_size = (uint64_t)st.st_size,
+			.source_mtime = (int64_t)st.st_mtime,
+			.width = a->width,
+			.height = a->height,
+			.flip_vertically = a->flip_vertically,
+		};
+		memcpy(h.magic,CACHE_MAGIC,sizeof(h.magic));
+		char temp[1040];
+		snprintf(temp,sizeof(temp),"%s.tmp",path);
+		FILE *f = fopen(temp,"wb");
+		if (f){
+			bool ok = fwrite(&h,sizeof(h),1,f) == 1 && fwrite(a->pixels,sizeof(*a->pixels)*a->width,a->height,f) == (size_t)a->height;
+			ok &= !fclose(f);
+#ifdef _WIN32
+			remove(path);
+#endif
+			if (!ok || rename(temp,path)){
+				remove(temp);
+			}
+		}
+	}
+	return true;
+}
+
+static void loader_thread(void *data){
+	profile_set_thread_name("assets");
+	thd_mutex_lock(&loader.mutex);
+	for (;;){
+		while (!loader.head && !loader.quit){
+			thd_condition_wait(&loader.wake,&loader.mutex);
+		}
+		asset_t *a = loader.head;
+		if (!a){
+			break;
+		}
+		loader.head = a->next;
+		if (!loader.head){
+			loader.tail = 0;
+		}
+		thd_mutex_unlock(&loader.mutex);
+
+		uint64_t t = profile_begin();
+		bool ok;
+		if (a->kind == ASSET_FILE){
+			ok = map_file(&a->map,a->path);
+			a->data = a->map.data;
+			a->size = a->map.size;
+		} else {
+			ok = read_image(a);
+		}
+		a->load_ns = get_time() - a->requested;
+		profile_end("asset load",t);
+
+		thd_mutex_lock(&loader.mutex);
+		atomic_store(&a->state,ok ? ASSET_READY : ASSET_FAILED);
+		thd_condition_broadcast(&loader.finished);
+	}
+	thd_mutex_unlock(&loader.mutex);
+}
+
+void assets_open(char *cache_dir){
+	assets_close();
+	memset(&loader,0,sizeof(loader));
+	if (cache_dir){
+		snprintf(loader.cache_dir,sizeof(loader.cache_dir),"%s",cache_dir);
+#ifdef _WIN32
+		_mkdir(cache_dir);
+#else
+		mkdir(cache_dir,0777);
+#endif
+	}
+	thd_mutex_init(&loader.mutex);
+	thd_condition_init(&loader.wake);
+	thd_condition_init(&loader.finished);
+	ASSERT(!thd_thread_detach(&loader.thread,loader_thread,0));
+	loader.open = true;
+}
+
+void assets_close(void){
+	if (!loader.open){
+		return;
+	}
+	thd_mutex_lock(&loader.mutex);
+	loader.quit = true;
+	thd_condition_signal(&loader.wake);
+	thd_mutex_unlock(&loader.mutex);
+	thd_thread_join(&loader.thread);
+	thd_condition_destroy(&loader.finished);
+	thd_condition_destroy(&loader.wake);
+	thd_mutex_destroy(&loader.mutex);
+	loader.open = false;
+}
+
+static asset_t *request(char *path, asset_kind_t kind, bool flip_vertically){
+	ASSERT(loader.open);
+	asset_t *a = calloc(1,sizeof(*a));
+	ASSERT(a);
+	snprintf(a->path,sizeof(a->path),"%s",path);
+	a->kind = kind;
+	a->flip_vertically = flip_vertically;
+	a->requested = get_time();
+	thd_mutex_lock(&loader.mutex);
+	if (loader.tail){
+		loader.tail->next = a;
+	} else {
+		loader.head = a;
+	}
+	loader.tail = a;
+	thd_condition_signal(&loader.wake);
+	thd_mutex_unlock(&loader.mutex);
+	return a;
+}
+
+asset_t *assets_load_file(char *path){
+	return request(path,ASSET_FILE,false);
+}
+
+asset_t *assets_load_image(char *path, bool flip_vertically){
+	return request(path,ASSET_IMAGE,flip_vertically);
+}
+
+asset_state_t asset_wait(asset_t *a){
+	if (asset_state(a) == ASSET_LOADING){
+		uint64_t t = profile_begin();
+		thd_mutex_lock(&loader.mutex);
+		while (asset_state(a) == ASSET_LOADING){
+			thd_condition_wait(&loader.finished,&loader.mutex);
+		}
+		thd_mutex_unlock(&loader.mutex);
+		profile_end("asset wait",t);
+	}
+	return asset_state(a);
+}
+
+void asset_free(asset_t *a){
+	ASSERT(asset_state(a) != ASSET_LOADING);
+	if (a->map.data){
+		unmap_file(&a->map);
+	} else {
+		free(a->pixels);
+	}
+	free(a);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "tiny3d.h"
+
+#include <stdatomic.h>
+
+//asynchronous asset loading. requests queue up for a loader thread and come back as handles
+//the caller polls or waits on, so nothing blocks on disk or decoding until it's actually needed.
+//decoded images are cached as raw rgba in the cache directory, and a cache that is newer than
+//its source is mapped straight in instead of decoding again.
+typedef enum {
+	ASSET_LOADING,
+	ASSET_READY,
+	ASSET_FAILED,
+} asset_state_t;
+
+typedef enum {
+	ASSET_FILE, //the file's bytes, mapped
+	ASSET_IMAGE, //rgba pixels, r in the first byte
+} asset_kind_t;
+
+typedef struct asset {
+	_Atomic int state; //asset_state_t, everything below is valid once it's ASSET_READY
+	asset_kind_t kind;
+	bool flip_vertically;
+	bool cached; //an image that came from the cache instead of the decoder
+	char path[512];
+	unsigned char *data; //ASSET_FILE
+	size_t size;
+	uint32_t *pixels; //ASSET_IMAGE
+	int width, height;
+	uint64_t load_ns; //from the request to ready or failed
+
+	//loader bookkeeping
+	mapped_file_t map;
+	uint64_t requested;
+	struct asset *next;
+} asset_t;
+
+void assets_open(char *cache_dir); //cache_dir 0: decode every time
+void assets_close(void); //finishes what is queued first
+
+//paths as fopen takes them, see local_path_to_absolute
+asset_t *assets_load_file(char *path);
+asset_t *assets_load_image(char *path, bool flip_vertically);
+
+static inline asset_state_t asset_state(asset_t *a){
+	return atomic_load(&a->state);
+}
+asset_state_t asset_wait(asset_t *a); //blocks until the asset is ready or failed
+void asset_free(asset_t *a); //only once it is no longer loading
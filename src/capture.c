@@ -0,0 +1,244 @@
+#include "capture.h"
+#include "thd.h"
+#include "profile.h"
+
+#include <stdatomic.h>
+
+//a finished frame as render left it, copied as is so the caller only pays for a memcpy
+typedef struct {
+	render_output_t output;
+	int width, height;
+	uint32_t frame;
+	uint64_t time;
+	void *pixels;
+	size_t capacity;
+} capture_slot_t;
+
+static struct {
+	bool open;
+	FILE *file;
+
+	//single producer, single consumer. capture_frame fills slots in order and the writer empties
+	//them in order, the counts on their own cache lines so the two threads don't share one.
+	capture_slot_t slots[CAPTURE_SLOTS];
+	_Alignas(64) _Atomic uint32_t filled;
+	_Alignas(64) _Atomic uint32_t emptied;
+	uint32_t calls; //capture_frame only
+	_Atomic uint64_t frames, dropped, bytes;
+	_Atomic bool failed;
+
+	//guarded by mutex
+	thd_thread thread;
+	thd_mutex mutex;
+	thd_condition wake;
+	bool quit;
+
+	//writer only
+	uint8_t *pixels, *previous, *encoded;
+	int capacity;
+	int width, height; //of previous, 0 before the first frame
+	int since_keyframe;
+} capture;
+
+int capture_encode(uint8_t *pixels, uint8_t *previous, int count, uint8_t *out){
+	int n = 0;
+	for (int i = 0; i < count;){
+		uint8_t v = pixels[i] ^ (previous ? previous[i] : 0);
+		int run = 1;
+		while (i+run < count && run < 271 && (uint8_t)(pixels[i+run] ^ (previous ? previous[i+run] : 0)) == v){
+			run++;
+		}
+		if (run < 16){
+			out[n++] = (uint8_t)((run-1) << 4 | v);
+		} else {
+			out[n++] = 0xf0 | v;
+			out[n++] = (uint8_t)(run-16);
+		}
+		i += run;
+	}
+	return n;
+}
+
+bool capture_decode(uint8_t *in, int size, uint8_t *pixels, int count){
+	int p = 0;
+	for (int i = 0; i < size; i++){
+		int run = (in[i] >> 4) + 1;
+		uint8_t v = in[i] & 15;
+		if (run == 16){
+			if (++i == size){
+				return false;
+			}
+			run += in[i];
+		}
+		if (run > count-p){
+			return false;
+		}
+		for (int k = 0; k < run; k++){
+			pixels[p+k] ^= v;
+		}
+		p += run;
+	}
+	return p == count;
+}
+
+//to one index per pixel
+static void quantize(capture_slot_t *s, uint8_t *out){
+	if (s->output == RENDER_OUTPUT_CGA_PACKED){
+		uint8_t *in = s->pixels;
+		int row = (s->width+1)/2;
+		for (int y = 0; y < s->height; y++){
+			for (int x = 0; x < s->width; x++){
+				uint8_t b = in[y*row + x/2];
+				*out++ = x & 1 ? b >> 4 : b & 15;
+			}
+		}
+	} else {
+		color_t *in = s->pixels;
+		for (int i = 0; i < s->width*s->height; i++){
+			out[i] = (uint8_t)tonemap_nearest_cga(in[i]);
+		}
+	}
+}
+
+static void write_slot(capture_slot_t *s){
+	uint64_t t = profile_begin();
+	int count = s->width*s->height;
+	if (count > capture.capacity){
+		capture.capacity = count;
+		capture.pixels = realloc(capture.pixels,count);
+		capture.previous = realloc(capture.previous,count);
+		capture.encoded = realloc(capture.encoded,count);
+		ASSERT(capture.pixels && capture.previous && capture.encoded);
+	}
+	quantize(s,capture.pixels);
+	bool key = s->width != capture.width || s->height != capture.height || capture.since_keyframe >= CAPTURE_KEYFRAME_INTERVAL;
+	capture_frame_header_t h = {
+		.size = (uint32_t)capture_encode(capture.pixels,key ? 0 : capture.previous,count,capture.encoded),
+		.frame = s->frame,
+		.time = s->time,
+		.width = (uint16_t)s->width,
+		.height = (uint16_t)s->height,
+		.flags = key ? CAPTURE_KEYFRAME : 0,
+	};
+	//after a failed write the rest of the file can't be trusted, nothing more goes in
+	if (!atomic_load(&capture.failed)){
+		if (fwrite(&h,sizeof(h),1,capture.file) == 1 && fwrite(capture.encoded,1,h.size,capture.file) == h.size){
+			atomic_fetch_add(&capture.frames,1);
+			atomic_fetch_add(&capture.bytes,sizeof(h) + h.size);
+		} else {
+			atomic_store(&capture.failed,true);
+		}
+	}
+	uint8_t *p = capture.previous;
+	capture.previous = capture.pixels;
+	capture.pixels = p;
+	capture.width = s->width;
+	capture.height = s->height;
+	capture.since_keyframe = key ? 1 : capture.since_keyframe+1;
+	profile_end("capture encode",t);
+}
+
+static void writer_thread(void *data){
+	profile_set_thread_name("capture");
+	for (;;){
+		thd_mutex_lock(&capture.mutex);
+		uint32_t e = atomic_load_explicit(&capture.emptied,memory_order_relaxed);
+		while (atomic_load_explicit(&capture.filled,memory_order_acquire) == e && !capture.quit){
+			thd_condition_wait(&capture.wake,&capture.mutex);
+		}
+		bool done = atomic_load_explicit(&capture.filled,memory_order_acquire) == e;
+		thd_mutex_unlock(&capture.mutex);
+		if (done){
+			break;
+		}
+		write_slot(capture.slots + e % CAPTURE_SLOTS);
+		atomic_store_explicit(&capture.emptied,e+1,memory_order_release);
+	}
+}
+
+bool capture_begin(char *path){
+	capture_end();
+	tonemap_init();
+	FILE *f = fopen(path,"wb");
+	if (!f){
+		return false;
+	}
+	capture_header_t h = {.version = CAPTURE_VERSION};
+	memcpy(h.magic,CAPTURE_MAGIC,sizeof(h.magic));
+	if (fwrite(&h,sizeof(h),1,f) != 1){
+		fclose(f);
+		return false;
+	}
+	capture.file = f;
+	capture.calls = 0;
+	capture.quit = false;
+	capture.width = capture.height = 0;
+	atomic_store(&capture.filled,0);
+	atomic_store(&capture.emptied,0);
+	atomic_store(&capture.frames,0);
+	atomic_store(&capture.dropped,0);
+	atomic_store(&capture.bytes,sizeof(h));
+	atomic_store(&capture.failed,false);
+	thd_mutex_init(&capture.mutex);
+	thd_condition_init(&capture.wake);
+	ASSERT(!thd_thread_detach(&capture.thread,writer_thread,0));
+	capture.open = true;
+	return true;
+}
+
+void capture_frame(void){
+	if (!capture.open || !screen){
+		return;
+	}
+	uint64_t t = profile_begin();
+	uint32_t f = atomic_load_explicit(&capture.filled,memory_order_relaxed);
+	uint32_t call = capture.calls++;
+	if (f - atomic_load_explicit(&capture.emptied,memory_order_acquire) == CAPTURE_SLOTS){
+		atomic_fetch_add(&capture.dropped,1);
+		profile_end("capture",t);
+		return;
+	}
+	capture_slot_t *s = capture.slots + f % CAPTURE_SLOTS;
+	bool packed = screen_output == RENDER_OUTPUT_CGA_PACKED;
+	size_t size = packed ? (size_t)((screen_width+1)/2)*screen_height : (size_t)screen_width*screen_height*sizeof(*screen);
+	if (size > s->capacity){
+		s->pixels = realloc(s->pixels,size);
+		ASSERT(s->pixels);
+		s->capacity = size;
+	}
+	memcpy(s->pixels,packed ? (void *)screen_packed : (void *)screen,size);
+	s->output = screen_output;
+	s->width = screen_width;
+	s->height = screen_height;
+	s->frame = call;
+	s->time = get_time();
+	atomic_store_explicit(&capture.filled,f+1,memory_order_release);
+	thd_mutex_lock(&capture.mutex);
+	thd_condition_signal(&capture.wake);
+	thd_mutex_unlock(&capture.mutex);
+	profile_end("capture",t);
+}
+
+void capture_end(void){
+	if (!capture.open){
+		return;
+	}
+	thd_mutex_lock(&capture.mutex);
+	capture.quit = true;
+	thd_condition_signal(&capture.wake);
+	thd_mutex_unlock(&capture.mutex);
+	thd_thread_join(&capture.thread);
+	if (fclose(capture.file)){
+		atomic_store(&capture.failed,true);
+	}
+	thd_condition_destroy(&capture.wake);
+	thd_mutex_destroy(&capture.mutex);
+	capture.open = false;
+}
+
+void capture_get_stats(capture_stats_t *s){
+	s->frames = atomic_load(&capture.frames);
+	s->dropped = atomic_load(&capture.dropped);
+	s->bytes = atomic_load(&capture.bytes);
+	s->failed = atomic_load(&capture.failed);
+}
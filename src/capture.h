@@ -0,0 +1,54 @@
+#pragma once
+
+#include "render.h"
+
+//gameplay capture. capture_frame copies the finished frame into one of a few slots and returns,
+//a writer thread quantizes it to cga_colors indices, xors it with the last frame it wrote and
+//run length encodes the result, so the parts of the picture that hold still cost next to
+//nothing. a frame that finds every slot still waiting to be written is dropped, never waited on.
+#define CAPTURE_MAGIC "t3dcapt1"
+#define CAPTURE_VERSION 1
+#define CAPTURE_SLOTS 8
+#define CAPTURE_KEYFRAME_INTERVAL 60 //frames between ones encoded on their own, to seek to
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t pad;
+} capture_header_t;
+_Static_assert(sizeof(capture_header_t) == 16,"the header is written as is");
+
+enum {
+	CAPTURE_KEYFRAME = 1, //encoded against a black frame instead of the previous one
+};
+
+//every frame is this header and size bytes of encoded pixels
+typedef struct {
+	uint32_t size;
+	uint32_t frame; //capture_frame calls before this one, dropped frames leave a gap
+	uint64_t time; //get_time() when it was captured
+	uint16_t width, height;
+	uint32_t flags; //CAPTURE_* bits
+} capture_frame_header_t;
+_Static_assert(sizeof(capture_frame_header_t) == 24,"the header is written as is");
+
+typedef struct {
+	uint64_t frames; //written
+	uint64_t dropped;
+	uint64_t bytes;
+	bool failed; //a write failed, nothing after it went into the file
+} capture_stats_t;
+
+bool capture_begin(char *path);
+void capture_frame(void); //the finished frame, after render_frame or render_frame_end
+void capture_end(void); //writes out what is still queued and closes the file
+void capture_get_stats(capture_stats_t *s);
+
+//the encoding, one byte per pixel holding its cga_colors index. every token is a byte with the
+//run length - 1 in the high nibble and the run's xor with the previous frame in the low one. a
+//high nibble of 15 takes the next byte too, for runs of 16 to 271. previous 0 is a black frame.
+//out needs count bytes, the worst case. returns the bytes written.
+int capture_encode(uint8_t *pixels, uint8_t *previous, int count, uint8_t *out);
+//xors the decoded runs onto pixels, which hold the previous frame. false if in doesn't cover
+//exactly count pixels.
+bool capture_decode(uint8_t *in, int size, uint8_t *pixels, int count);
@@ -0,0 +1,213 @@
+#include "entity.h"
+#include "world.h"
+#include "pool.h"
+#include "profile.h"
+
+double interpolant;
+
+void entity_set_position(entity_t *e, float x, float y, float z){
+	e->current_position[0] = x;
+	e->current_position[1] = y;
+	e->current_position[2] = z;
+	e->previous_position[0] = x;
+	e->previous_position[1] = y;
+	e->previous_position[2] = z;
+}
+
+void get_entity_interpolated_position(entity_t *e, vec3 position){
+	vec3_lerp(e->previous_position,e->current_position,(float)interpolant,position);
+}
+
+void get_entity_mmbb(entity_t *e, mmbb_t *m){
+	m->min[0] = e->current_position[0]-0.5f*e->width;
+	m->min[1] = e->current_position[1]-0.5f*e->height;
+	m->min[2] = e->current_position[2]-0.5f*e->width;
+	m->max[0] = e->current_position[0]+0.5f*e->width;
+	m->max[1] = e->current_position[1]+0.5f*e->height;
+	m->max[2] = e->current_position[2]+0.5f*e->width;
+}
+
+void get_expanded_mmbb(mmbb_t *src, mmbb_t *dst, vec3 v){
+	*dst = *src;
+	for (int i = 0; i < 3; i++){
+		if (v[i] > 0){
+			dst->max[i] += v[i];
+		} else {
+			dst->min[i] += v[i];
+		}
+	}
+}
+
+void get_mmbb_center(mmbb_t *m, vec2 c){
+	for (int i = 0; i < 3; i++){
+		c[i] = m->min[i] + 0.5f*(m->max[i]-m->min[i]);
+	}
+}
+
+entity_store_t entities;
+
+//gathers the solid cells of a box once so the three axis sweeps only visit those.
+//cells stay in the y,z,x order the sweeps used to scan them in.
+static int gather_solid_cells(immbb_t *im, ivec3 **cells, ivec3 *local, int local_count){
+	int volume = (im->max[0]-im->min[0]+1)*(im->max[1]-im->min[1]+1)*(im->max[2]-im->min[2]+1);
+	*cells = volume <= local_count ? local : malloc(volume*sizeof(ivec3));
+	ASSERT(*cells);
+	int count = 0;
+	for (int y = im->min[1]; y <= im->max[1]; y++){
+		for (int z = im->min[2]; z <= im->max[2]; z++){
+			for (int x = im->min[0]; x <= im->max[0]; x++){
+				block_t *b = get_block(x,y,z);
+				if (b && *b){
+					(*cells)[count][0] = x;
+					(*cells)[count][1] = y;
+					(*cells)[count][2] = z;
+					count++;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+//moves a box by its velocity, resolving collisions one axis at a time: y, then x, then z.
+static void move_box(vec3 previous_position, vec3 position, vec3 velocity, float width, float height, bool *on_ground){
+	vec3_copy(position,previous_position);
+	velocity[1] -= 0.075f; //gravity
+	vec3 d;
+	vec3_copy(velocity,d);
+
+	mmbb_t m,em;
+	m.min[0] = position[0]-0.5f*width;
+	m.min[1] = position[1]-0.5f*height;
+	m.min[2] = position[2]-0.5f*width;
+	m.max[0] = position[0]+0.5f*width;
+	m.max[1] = position[1]+0.5f*height;
+	m.max[2] = position[2]+0.5f*width;
+	get_expanded_mmbb(&m,&em,d);
+	immbb_t im;
+	for (int i = 0; i < 3; i++){
+		im.min[i] = (int)floorf(em.min[i]);
+		im.max[i] = (int)floorf(em.max[i]);
+	}
+
+	ivec3 local[64], *cells;
+	int count = gather_solid_cells(&im,&cells,local,COUNT(local));
+
+	//a, b: the axes the box has to overlap a cell on for the cell to block movement along axis
+	static const int axes[3][3] = {{1,0,2},{0,1,2},{2,1,0}};
+	for (int k = 0; k < 3; k++){
+		int axis = axes[k][0], a = axes[k][1], b = axes[k][2];
+		for (int i = 0; i < count; i++){
+			int *c = cells[i];
+			if (m.min[a] < (c[a]+1) && m.max[a] > c[a] &&
+				m.min[b] < (c[b]+1) && m.max[b] > c[b]){
+				if (d[axis] < 0 && m.min[axis] >= (c[axis]+1)){
+					float nd = (c[axis]+1) - m.min[axis];
+					if (nd > d[axis]){
+						d[axis] = nd + 0.001f;
+					}
+				} else if (d[axis] > 0 && m.max[axis] <= c[axis]){
+					float nd = c[axis] - m.max[axis];
+					if (nd < d[axis]){
+						d[axis] = nd - 0.001f;
+					}
+				}
+			}
+		}
+		m.min[axis] += d[axis];
+		m.max[axis] += d[axis];
+	}
+	if (cells != local){
+		free(cells);
+	}
+
+	get_mmbb_center(&m,position);
+
+	if (d[0] != velocity[0]){
+		velocity[0] = 0.0f;
+	}
+	if (d[2] != velocity[2]){
+		velocity[2] = 0.0f;
+	}
+	if (d[1] != velocity[1]){
+		if (velocity[1] < 0.0f){
+			*on_ground = true;
+		}
+		velocity[1] = 0.0f;
+	} else {
+		*on_ground = false;
+	}
+}
+
+void update_entity(entity_t *e){
+	move_box(e->previous_position,e->current_position,e->velocity,e->width,e->height,&e->on_ground);
+}
+
+int add_entity(float width, float height, vec3 position, vec3 velocity){
+	entity_store_t *s = &entities;
+	int id;
+	if (s->free_count){
+		id = s->free_list[--s->free_count];
+	} else {
+		if (s->count == s->capacity){
+			s->capacity = s->capacity ? 2*s->capacity : 64;
+			s->previous_position = realloc(s->previous_position,s->capacity*sizeof(vec3));
+			s->current_position = realloc(s->current_position,s->capacity*sizeof(vec3));
+			s->velocity = realloc(s->velocity,s->capacity*sizeof(vec3));
+			s->extent = realloc(s->extent,s->capacity*sizeof(vec2));
+			s->on_ground = realloc(s->on_ground,s->capacity*sizeof(bool));
+			s->active = realloc(s->active,s->capacity*sizeof(bool));
+			s->free_list = realloc(s->free_list,s->capacity*sizeof(int));
+			ASSERT(s->previous_position && s->current_position && s->velocity && s->extent && s->on_ground && s->active && s->free_list);
+		}
+		id = s->count++;
+	}
+	vec3_copy(position,s->previous_position[id]);
+	vec3_copy(position,s->current_position[id]);
+	vec3_copy(velocity,s->velocity[id]);
+	s->extent[id][0] = width;
+	s->extent[id][1] = height;
+	s->on_ground[id] = false;
+	s->active[id] = true;
+	return id;
+}
+
+void remove_entity(int id){
+	entity_store_t *s = &entities;
+	ASSERT(id >= 0 && id < s->count && s->active[id]);
+	s->active[id] = false;
+	s->free_list[s->free_count++] = id;
+}
+
+void clear_entities(void){
+	entities.count = 0;
+	entities.free_count = 0;
+}
+
+void get_stored_entity_position(int id, vec3 position){
+	vec3_lerp(entities.previous_position[id],entities.current_position[id],(float)interpolant,position);
+}
+
+//entities don't collide with each other and only read the world, so batches are independent
+#define ENTITY_BATCH 256
+
+static void update_entity_batch(int job_index, int thread_index, void *data){
+	uint64_t t = profile_begin();
+	entity_store_t *s = &entities;
+	int end = MIN(s->count,(job_index+1)*ENTITY_BATCH);
+	for (int i = job_index*ENTITY_BATCH; i < end; i++){
+		if (s->active[i]){
+			move_box(s->previous_position[i],s->current_position[i],s->velocity[i],s->extent[i][0],s->extent[i][1],s->on_ground+i);
+		}
+	}
+	profile_end("entities",t);
+}
+
+pool_t *entity_pool;
+
+void update_entities(void){
+	int batches = (entities.count+ENTITY_BATCH-1)/ENTITY_BATCH;
+	if (batches){
+		pool_run(entity_pool,batches,update_entity_batch,0);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "tiny3d.h"
+#include "pool.h"
+
+extern double interpolant;
+
+typedef struct {
+	vec3 min,max;
+} mmbb_t;
+
+typedef struct {
+	ivec3 min,max;
+} immbb_t;
+
+typedef struct {
+	bool on_ground;
+	float width, height;
+	vec3 previous_position;
+	vec3 current_position;
+	vec3 velocity;
+	vec2 head_rotation;
+} entity_t;
+
+void entity_set_position(entity_t *e, float x, float y, float z);
+void get_entity_interpolated_position(entity_t *e, vec3 position);
+void get_entity_mmbb(entity_t *e, mmbb_t *m);
+void get_expanded_mmbb(mmbb_t *src, mmbb_t *dst, vec3 v);
+void get_mmbb_center(mmbb_t *m, vec2 c);
+void update_entity(entity_t *e);
+
+//growable structure of arrays for bodies that only need physics, like lights. an id indexes
+//every array and stays valid until remove_entity puts it on the free list.
+typedef struct {
+	int count; //ids in use or free are all below count
+	int capacity;
+	vec3 *previous_position;
+	vec3 *current_position;
+	vec3 *velocity;
+	vec2 *extent; //width, height
+	bool *on_ground;
+	bool *active;
+	int *free_list;
+	int free_count;
+} entity_store_t;
+extern entity_store_t entities;
+
+//from whichever thread ticks the entities (the sim thread while it runs, otherwise the main
+//thread), never during update_entities
+int add_entity(float width, float height, vec3 position, vec3 velocity);
+void remove_entity(int id);
+void clear_entities(void);
+void get_stored_entity_position(int id, vec3 position); //interpolated like get_entity_interpolated_position
+
+//one tick for every active stored entity with the same collision rules as update_entity,
+//in batches spread over entity_pool, 0 for the shared worker pool.
+extern pool_t *entity_pool;
+void update_entities(void);
@@ -1,332 +1,26 @@
 #include "tiny3d.h"
-#include "thd.h"
-
-double accumulated_time = 0.0;
-double interpolant;
-#define TICK_RATE 20.0
-#define SEC_PER_TICK (1.0 / TICK_RATE)
-
-typedef struct {
-	uint8_t r,g,b,a;
-} color_t;
-
-#define SCREEN_WIDTH 160
-#define SCREEN_HEIGHT 100
-color_t screen[SCREEN_WIDTH*SCREEN_HEIGHT];
-
-color_t cga_colors[] = {
-	{0x00,0x00,0x00,0xFF},
-	{0x00,0x00,0xAA,0xFF},
-	{0x00,0xAA,0x00,0xFF},
-	{0x00,0xAA,0xAA,0xFF},
-	{0xAA,0x00,0x00,0xFF},
-	{0xAA,0x00,0xAA,0xFF},
-	{0xAA,0x55,0x00,0xFF},
-	{0xAA,0xAA,0xAA,0xFF},
-	{0x55,0x55,0x55,0xFF},
-	{0x55,0x55,0xFF,0xFF},
-	{0x55,0xFF,0x55,0xFF},
-	{0x55,0xFF,0xFF,0xFF},
-	{0xFF,0x55,0x55,0xFF},
-	{0xFF,0x55,0xFF,0xFF},
-	{0xFF,0xFF,0x55,0xFF},
-	{0xFF,0xFF,0xFF,0xFF},
-};
-
-typedef struct {
-	vec3 min,max;
-} mmbb_t;
-
-typedef struct {
-	ivec3 min,max;
-} immbb_t;
-
-typedef uint8_t block_t;
-
-#define WORLD_WIDTH 32
-block_t world[WORLD_WIDTH*WORLD_WIDTH*WORLD_WIDTH];
-
-block_t *get_block(int x, int y, int z){
-	if (x >= 0 && x < WORLD_WIDTH &&
-		y >= 0 && y < WORLD_WIDTH &&
-		z >= 0 && z < WORLD_WIDTH){
-		return world + y*WORLD_WIDTH*WORLD_WIDTH + z*WORLD_WIDTH + x;
-	} else {
-		return 0;
-	}
-}
-
-typedef struct {
-	bool on_ground;
-	float width, height;
-	vec3 previous_position;
-	vec3 current_position;
-	vec3 velocity;
-	vec2 head_rotation;
-} entity_t;
-
-entity_t player = {
-	.width = 0.6f,
-	.height = 1.8f,
-};
-
-void entity_set_position(entity_t *e, float x, float y, float z){
-	e->current_position[0] = x;
-	e->current_position[1] = y;
-	e->current_position[2] = z;
-	e->previous_position[0] = x;
-	e->previous_position[1] = y;
-	e->previous_position[2] = z;
-}
-
-void get_entity_interpolated_position(entity_t *e, vec3 position){
-	vec3_lerp(e->previous_position,e->current_position,(float)interpolant,position);
-}
-
-void get_entity_mmbb(entity_t *e, mmbb_t *m){
-	m->min[0] = e->current_position[0]-0.5f*e->width;
-	m->min[1] = e->current_position[1]-0.5f*e->height;
-	m->min[2] = e->current_position[2]-0.5f*e->width;
-	m->max[0] = e->current_position[0]+0.5f*e->width;
-	m->max[1] = e->current_position[1]+0.5f*e->height;
-	m->max[2] = e->current_position[2]+0.5f*e->width;
-}
-
-void get_expanded_mmbb(mmbb_t *src, mmbb_t *dst, vec3 v){
-	*dst = *src;
-	for (int i = 0; i < 3; i++){
-		if (v[i] > 0){
-			dst->max[i] += v[i];
-		} else {
-			dst->min[i] += v[i];
-		}
-	}
-}
-
-void get_mmbb_center(mmbb_t *m, vec2 c){
-	for (int i = 0; i < 3; i++){
-		c[i] = m->min[i] + 0.5f*(m->max[i]-m->min[i]);
-	}
-}
-
-void update_entity(entity_t *e){
-	vec3_copy(e->current_position,e->previous_position);
-	e->velocity[1] -= 0.075f; //gravity
-	vec3 d;
-	vec3_copy(e->velocity,d);
-
-	mmbb_t m,em;
-	get_entity_mmbb(e,&m);
-	get_expanded_mmbb(&m,&em,d);
-	immbb_t im;
-	for (int i = 0; i < 3; i++){
-		im.min[i] = (int)floorf(em.min[i]);
-		im.max[i] = (int)floorf(em.max[i]);
-	}
-
-	for (int y = im.min[1]; y <= im.max[1]; y++){
-		for (int z = im.min[2]; z <= im.max[2]; z++){
-			for (int x = im.min[0]; x <= im.max[0]; x++){
-				block_t *b = get_block(x,y,z);
-				if (b && *b &&
-					m.min[0] < (x+1) && m.max[0] > x &&
-					m.min[2] < (z+1) && m.max[2] > z){
-					if (d[1] < 0 && m.min[1] >= (y+1)){
-						float nd = (y+1) - m.min[1];
-						if (nd > d[1]){
-							d[1] = nd + 0.001f;
-						}
-					} else if (d[1] > 0 && m.max[1] <= y){
-						float nd = y - m.max[1];
-						if (nd < d[1]){
-							d[1] = nd - 0.001f;
-						}
-					}
-				}
-			}
-		}
-	}
-	m.min[1] += d[1];
-	m.max[1] += d[1];
-
-	for (int y = im.min[1]; y <= im.max[1]; y++){
-		for (int z = im.min[2]; z <= im.max[2]; z++){
-			for (int x = im.min[0]; x <= im.max[0]; x++){
-				block_t *b = get_block(x,y,z);
-				if (b && *b &&
-					m.min[1] < (y+1) && m.max[1] > y &&
-					m.min[2] < (z+1) && m.max[2] > z){
-					if (d[0] < 0 && m.min[0] >= (x+1)){
-						float nd = (x+1) - m.min[0];
-						if (nd > d[0]){
-							d[0] = nd + 0.001f;
-						}
-					} else if (d[0] > 0 && m.max[0] <= x){
-						float nd = x - m.max[0];
-						if (nd < d[0]){
-							d[0] = nd - 0.001f;
-						}
-					}
-				}
-			}
-		}
-	}
-	m.min[0] += d[0];
-	m.max[0] += d[0];
-
-	for (int y = im.min[1]; y <= im.max[1]; y++){
-		for (int z = im.min[2]; z <= im.max[2]; z++){
-			for (int x = im.min[0]; x <= im.max[0]; x++){
-				block_t *b = get_block(x,y,z);
-				if (b && *b &&
-					m.min[1] < (y+1) && m.max[1] > y &&
-					m.min[0] < (x+1) && m.max[0] > x){
-					if (d[2] < 0 && m.min[2] >= (z+1)){
-						float nd = (z+1) - m.min[2];
-						if (nd > d[2]){
-							d[2] = nd + 0.001f;
-						}
-					} else if (d[2] > 0 && m.max[2] <= z){
-						float nd = z - m.max[2];
-						if (nd < d[2]){
-							d[2] = nd - 0.001f;
-						}
-					}
-				}
-			}
-		}
-	}
-	m.min[2] += d[2];
-	m.max[2] += d[2];
-
-	get_mmbb_center(&m,e->current_position);
-
-	if (d[0] != e->velocity[0]){
-		e->velocity[0] = 0.0f;
-	}
-	if (d[2] != e->velocity[2]){
-		e->velocity[2] = 0.0f;
-	}
-	if (d[1] != e->velocity[1]){
-		if (e->velocity[1] < 0.0f){
-			e->on_ground = true;
-		}
-		e->velocity[1] = 0.0f;
-	} else {
-		e->on_ground = false;
-	}
-}
-
-typedef struct {
-	block_t *block;
-	ivec3 block_pos;
-	ivec3 face_normal;
-	float t;
-} block_raycast_result_t;
-
-void cast_ray_into_blocks(vec3 origin, vec3 ray, block_raycast_result_t *result){
-	result->block_pos[0] = (int)floorf(origin[0]);
-	result->block_pos[1] = (int)floorf(origin[1]);
-	result->block_pos[2] = (int)floorf(origin[2]);
-	vec3 da;
-	for (int i = 0; i < 3; i++){
-		if (ray[i] < 0){
-			da[i] = ((float)result->block_pos[i]-origin[i]) / ray[i];
-		} else {
-			da[i] = ((float)result->block_pos[i]+1.0f-origin[i]) / ray[i];	
-		}
-	}
-	result->t = 0;
-	int index = 0;
-	while (result->t <= 1.0f){
-		result->block = get_block(result->block_pos[0],result->block_pos[1],result->block_pos[2]);
-		if (result->block && result->block[0]){
-			for (int i = 0; i < 3; i++){
-				result->face_normal[i] = 0;
-			}
-			result->face_normal[index] = ray[index] < 0 ? 1 : -1;
-			return;
-		}
-		float d = HUGE_VALF;
-		index = 0;
-		for (int i = 0; i < 3; i++){
-			if (da[i] < d){
-				index = i;
-				d = da[i];
-			}
-		}
-		result->block_pos[index] += ray[index] < 0 ? -1 : 1;
-		result->t += da[index];
-		for (int i = 0; i < 3; i++){
-			da[i] -= d;
-		}
-		da[index] = fabsf(1.0f / ray[index]);
-	}
-	result->block = 0;
-}
-
-typedef struct {
-	entity_t entity;
-	color_t color;
-	float range;
-} light_t;
-light_t lights[16];
-int light_count = 0;
-
-void get_player_eye_ray(vec3 eye, vec3 ray){
-	get_entity_interpolated_position(&player,eye);
-	eye[1] += 1.62f-0.9f;
-	ray[0] = 0.0f;
-	ray[1] = 0.0f;
-	ray[2] = -1.0f;
-	vec3_rotate_deg(ray,(vec3){1,0,0},player.head_rotation[0],ray);
-	vec3_rotate_deg(ray,(vec3){0,1,0},player.head_rotation[1],ray);
-}
-
-void shoot_light(){
-	vec3 eye,ray;
-	get_player_eye_ray(eye,ray);
-	light_t *light = lights+light_count;
-	light->color.r = rand()%255;
-	light->color.g = rand()%255;
-	light->color.b = rand()%255;
-	light->range = 8.0f;
-	memset(&light->entity,0,sizeof(light->entity));
-	light->entity.width = 0.25f;
-	light->entity.height = 0.25f;
-	vec3_copy(eye,light->entity.current_position);
-	vec3_scale(ray,3.0f,ray);
-	vec3_add(light->entity.current_position,ray,light->entity.current_position);
-	vec3_copy(light->entity.current_position,light->entity.previous_position);
-	vec3_copy(ray,light->entity.velocity);
-	light_count++;
-}
-
-/*void get_player_target_block(block_raycast_result_t *result){
-	vec3 head;
-	get_player_head_pos(head);
-	vec3 ray = {0,0,-5};
-	vec3_rotate_deg(ray,(vec3){1,0,0},-player.head_rotation[0],ray);
-	vec3_rotate_deg(ray,(vec3){0,1,0},-player.head_rotation[1],ray);
-	cast_ray_into_blocks(head,ray,result);
-}*/
+#include "world.h"
+#include "render.h"
+#include "profile.h"
+#include "mixer.h"
+#include "assets.h"
+#include "replay.h"
+#include "capture.h"
+#include "net.h"
+
+//the sim runs on its own thread, these are handed to it every frame
+keys_t input;
+vec2 look;
+
+sound_t shoot_sound;
+asset_t *block_atlas;
+char *record_path;
+char *capture_path;
+char *join_path;
+net_client_t net; //the server's while joined, socket -1 otherwise
 
 float mouse_sensitivity = 0.1f;
 
-struct {
-	bool
-		left,
-		right,
-		backward,
-		forward,
-		jump,
-		crouch,
-		attack,
-		just_attacked,
-		interact,
-		just_interacted;
-} keys;
-
 void keydown(int key){
 	static bool fog = false;
 	switch (key){
@@ -334,15 +28,19 @@ void keydown(int key){
 		case 'P': toggle_fullscreen(); break;
 		case 'C': lock_mouse(!is_mouse_locked()); break;
 		case 'F': fog ? glDisable(GL_FOG) : glEnable(GL_FOG); fog = !fog; break;
-		case 'W': keys.forward = true; break;
-		case 'A': keys.left = true; break;
-		case 'S': keys.backward = true; break;
-		case 'D': keys.right = true; break;
-		case ' ': keys.jump = true; break;
-		case KEY_MOUSE_LEFT:{
-			shoot_light();
-			break;
-		}
+		case 'T': render_temporal = !render_temporal; break;
+		case 'M': render_output = (render_output+1) % RENDER_OUTPUT_COUNT; printf("output: %s\n",render_output_names[render_output]); break;
+		case 'N': render_dither = !render_dither; break;
+		case 'X': render_textures = !render_textures; break;
+		case 'L': render_lighting = (render_lighting+1) % RENDER_LIGHTING_COUNT; printf("lighting: %s\n",render_lighting_names[render_lighting]); break;
+		case 'O': profile_enabled = !profile_enabled; break;
+		case 'I': puts(profile_write_trace("trace.json") ? "wrote trace.json" : "couldn't write trace.json"); break;
+		case 'W': input.forward = true; break;
+		case 'A': input.left = true; break;
+		case 'S': input.backward = true; break;
+		case 'D': input.right = true; break;
+		case ' ': input.jump = true; break;
+		case KEY_MOUSE_LEFT: input.just_attacked = true; break;
 		case KEY_MOUSE_RIGHT:{
 			break;
 		}
@@ -351,28 +49,62 @@ void keydown(int key){
 
 void keyup(int key){
 	switch (key){
-		case 'W': keys.forward = false; break;
-		case 'A': keys.left = false; break;
-		case 'S': keys.backward = false; break;
-		case 'D': keys.right = false; break;
-		case ' ': keys.jump = false; break;
+		case 'W': input.forward = false; break;
+		case 'A': input.left = false; break;
+		case 'S': input.backward = false; break;
+		case 'D': input.right = false; break;
+		case ' ': input.jump = false; break;
 	}
 }
 
 void mousemove(int x, int y){
 	if (is_mouse_locked()){
-		player.head_rotation[0] -= y*mouse_sensitivity;
-		if (player.head_rotation[0] < -90.0){
-			player.head_rotation[0] = -90.0;
-		} else if (player.head_rotation[0] > 90.0){
-			player.head_rotation[0] = 90.0;
+		look[0] -= y*mouse_sensitivity;
+		if (look[0] < -90.0){
+			look[0] = -90.0;
+		} else if (look[0] > 90.0){
+			look[0] = 90.0;
+		}
+		look[1] -= x*mouse_sensitivity;
+		while (look[1] > 360.0){
+			look[1] -= 360.0;
+		}
+		while (look[1] < 0){
+			look[1] += 360.0;
 		}
-		player.head_rotation[1] -= x*mouse_sensitivity;
-		while (player.head_rotation[1] > 360.0){
-			player.head_rotation[1] -= 360.0;
+	}
+}
+
+void platform_timing(char *name, uint64_t start, uint64_t end){
+	if (profile_enabled){
+		profile_record(name,start,end);
+	}
+}
+
+//rolling summary of the last second: a bar per zone across the top of the frame, where the
+//full width is 1/60 s of time summed over threads, and the numbers on stdout every second.
+void draw_profile(void){
+	static profile_zone_t zones[PROFILE_MAX_ZONES];
+	static int zone_count;
+	static uint64_t last_summary, last_print;
+	uint64_t now = get_time();
+	if (now - last_summary > 250000000ull){
+		last_summary = now;
+		zone_count = profile_summary(zones,COUNT(zones),"frame",1000000000ull);
+		if (now - last_print > 1000000000ull){
+			last_print = now;
+			for (int z = 0; z < zone_count; z++){
+				printf("%-12s %7.3f ms/frame  busiest thread %7.3f  threads %d\n",zones[z].name,zones[z].ms_per_frame,zones[z].max_thread_ms_per_frame,zones[z].threads);
+			}
+			printf("\n");
 		}
-		while (player.head_rotation[1] < 0){
-			player.head_rotation[1] += 360.0;
+	}
+	for (int z = 0; z < zone_count; z++){
+		int length = MIN(screen_width,(int)(zones[z].ms_per_frame * 60.0f / 1000.0f * screen_width));
+		for (int y = screen_height-2-3*z; y < screen_height-3*z && y >= 0; y++){
+			for (int x = 0; x < length; x++){
+				render_plot_cga(x,y,1 + z%15);
+			}
 		}
 	}
 }
@@ -386,40 +118,161 @@ extern void zoom(float zoomDelta){
 extern void rotate(float angleDelta){
 }
 
-void tick(){
-	ivec2 move_dir;
-	if (keys.left && keys.right){
-		move_dir[0] = 0;
-	} else if (keys.left){
-		move_dir[0] = -1;
-	} else if (keys.right){
-		move_dir[0] = 1;
-	} else {
-		move_dir[0] = 0;
+//pixel buffer objects and shaders are core since 1.5 and 2.0 but windows headers stop at 1.1
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+#define PIXEL_UNPACK_BUFFER 0x88EC
+#define STREAM_DRAW 0x88E0
+#define FRAGMENT_SHADER 0x8B30
+#define LINK_STATUS 0x8B82
+
+static struct {
+	bool loaded, have_buffers, have_shaders;
+	void (APIENTRY *GenBuffers)(GLsizei n, GLuint *buffers);
+	void (APIENTRY *BindBuffer)(GLenum target, GLuint buffer);
+	void (APIENTRY *BufferData)(GLenum target, intptr_t size, const void *data, GLenum usage);
+	void (APIENTRY *BufferSubData)(GLenum target, intptr_t offset, intptr_t size, const void *data);
+	GLuint (APIENTRY *CreateShader)(GLenum type);
+	void (APIENTRY *ShaderSource)(GLuint shader, GLsizei count, const char **strings, const GLint *lengths);
+	void (APIENTRY *CompileShader)(GLuint shader);
+	GLuint (APIENTRY *CreateProgram)(void);
+	void (APIENTRY *AttachShader)(GLuint program, GLuint shader);
+	void (APIENTRY *LinkProgram)(GLuint program);
+	void (APIENTRY *GetProgramiv)(GLuint program, GLenum name, GLint *value);
+	void (APIENTRY *UseProgram)(GLuint program);
+	GLint (APIENTRY *GetUniformLocation)(GLuint program, const char *name);
+	void (APIENTRY *Uniform1f)(GLint location, GLfloat value);
+	void (APIENTRY *Uniform4fv)(GLint location, GLsizei count, const GLfloat *values);
+} gl;
+
+static void load_gl(void){
+	gl.loaded = true;
+	gl.GenBuffers = gl_get_proc_address("glGenBuffers");
+	gl.BindBuffer = gl_get_proc_address("glBindBuffer");
+	gl.BufferData = gl_get_proc_address("glBufferData");
+	gl.BufferSubData = gl_get_proc_address("glBufferSubData");
+	gl.have_buffers = gl.GenBuffers && gl.BindBuffer && gl.BufferData && gl.BufferSubData;
+	gl.CreateShader = gl_get_proc_address("glCreateShader");
+	gl.ShaderSource = gl_get_proc_address("glShaderSource");
+	gl.CompileShader = gl_get_proc_address("glCompileShader");
+	gl.CreateProgram = gl_get_proc_address("glCreateProgram");
+	gl.AttachShader = gl_get_proc_address("glAttachShader");
+	gl.LinkProgram = gl_get_proc_address("glLinkProgram");
+	gl.GetProgramiv = gl_get_proc_address("glGetProgramiv");
+	gl.UseProgram = gl_get_proc_address("glUseProgram");
+	gl.GetUniformLocation = gl_get_proc_address("glGetUniformLocation");
+	gl.Uniform1f = gl_get_proc_address("glUniform1f");
+	gl.Uniform4fv = gl_get_proc_address("glUniform4fv");
+	gl.have_shaders = gl.CreateShader && gl.ShaderSource && gl.CompileShader && gl.CreateProgram && gl.AttachShader &&
+		gl.LinkProgram && gl.GetProgramiv && gl.UseProgram && gl.GetUniformLocation && gl.Uniform1f && gl.Uniform4fv;
+}
+
+//expands the packed cga frame: the texture holds a byte per two pixels, the left one in the low nibble
+static char *unpack_source =
+	"uniform sampler2D indices;\n"
+	"uniform vec4 palette[16];\n"
+	"uniform float width, texels;\n"
+	"void main(){\n"
+	"	float x = floor(gl_TexCoord[0].x * width);\n"
+	"	float byte = floor(texture2D(indices,vec2((floor(x / 2.0) + 0.5) / texels,gl_TexCoord[0].y)).r * 255.0 + 0.5);\n"
+	"	float high = floor(byte / 16.0);\n"
+	"	gl_FragColor = palette[int(mod(x,2.0) < 0.5 ? byte - high * 16.0 : high)];\n"
+	"}\n";
+
+static GLuint unpack_program;
+static GLint unpack_width, unpack_texels;
+
+static void create_unpack_program(void){
+	GLuint shader = gl.CreateShader(FRAGMENT_SHADER);
+	gl.ShaderSource(shader,1,(const char **)&unpack_source,0);
+	gl.CompileShader(shader);
+	GLuint program = gl.CreateProgram();
+	gl.AttachShader(program,shader);
+	gl.LinkProgram(program);
+	GLint linked = 0;
+	gl.GetProgramiv(program,LINK_STATUS,&linked);
+	if (!linked){
+		return;
 	}
-	if (keys.backward && keys.forward){
-		move_dir[1] = 0;
-	} else if (keys.backward){
-		move_dir[1] = 1;
-	} else if (keys.forward){
-		move_dir[1] = -1;
-	} else {
-		move_dir[1] = 0;
+	float palette[16][4];
+	for (int i = 0; i < 16; i++){
+		palette[i][0] = cga_colors[i].r / 255.0f;
+		palette[i][1] = cga_colors[i].g / 255.0f;
+		palette[i][2] = cga_colors[i].b / 255.0f;
+		palette[i][3] = 1.0f;
 	}
-	vec3 move_vec = {(float)move_dir[0],0,(float)move_dir[1]};
-	if (move_dir[0] || move_dir[1]){
-		vec3_normalize(move_vec,move_vec);
-		vec3_scale(move_vec,0.25f,move_vec);
-		vec3_rotate_deg(move_vec,(vec3){0,1,0},player.head_rotation[1],move_vec);
+	gl.UseProgram(program);
+	gl.Uniform4fv(gl.GetUniformLocation(program,"palette"),16,palette[0]);
+	gl.UseProgram(0);
+	unpack_width = gl.GetUniformLocation(program,"width");
+	unpack_texels = gl.GetUniformLocation(program,"texels");
+	unpack_program = program;
+}
+
+//the finished frame goes to the texture through one of two pixel buffers, taking turns, so the
+//driver can do the copy asynchronously and never has the buffer being written still in use.
+//texture and buffer storage is only allocated again when the resolution or output changes.
+//a packed cga frame is uploaded as is and expanded by unpack_program while drawing.
+void upload_screen(void){
+	static GLuint texture, buffers[2];
+	static int width, height, next;
+	static bool packed;
+	if (!gl.loaded){
+		load_gl();
+		if (gl.have_buffers){
+			gl.GenBuffers(COUNT(buffers),buffers);
+		}
+		if (gl.have_shaders){
+			create_unpack_program();
+		}
+		glGenTextures(1,&texture);
+		glBindTexture(GL_TEXTURE_2D,texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glPixelStorei(GL_UNPACK_ALIGNMENT,1);
 	}
-	player.velocity[0] = LERP(player.velocity[0],move_vec[0],0.3f);
-	player.velocity[2] = LERP(player.velocity[2],move_vec[2],0.3f);
-	if (player.on_ground && keys.jump){
-		player.velocity[1] = 0.5f;
+	if (screen_output == RENDER_OUTPUT_CGA_PACKED && !unpack_program){
+		//nothing to expand it with, so it's done here once and later frames come unpacked
+		render_output = RENDER_OUTPUT_CGA;
+		for (int y = 0; y < screen_height; y++){
+			for (int x = 0; x < screen_width; x++){
+				uint8_t b = screen_packed[y*((screen_width+1)/2) + x/2];
+				screen[y*screen_width+x] = cga_colors[x & 1 ? b >> 4 : b & 15];
+			}
+		}
+		screen_output = RENDER_OUTPUT_CGA;
 	}
-	update_entity(&player);
-	for (int i = 0; i < light_count; i++){
-		update_entity(&lights[i].entity);
+	bool p = screen_output == RENDER_OUTPUT_CGA_PACKED;
+	int texels = p ? (screen_width+1)/2 : screen_width;
+	GLenum format = p ? GL_LUMINANCE : GL_RGBA;
+	void *pixels = p ? (void *)screen_packed : (void *)screen;
+	intptr_t size = texels*screen_height*(p ? 1 : sizeof(*screen));
+	if (width != screen_width || height != screen_height || packed != p){
+		width = screen_width;
+		height = screen_height;
+		packed = p;
+		glTexImage2D(GL_TEXTURE_2D, 0, p ? GL_LUMINANCE8 : GL_RGBA, texels, height, 0, format, GL_UNSIGNED_BYTE, 0);
+		for (int i = 0; gl.have_buffers && i < COUNT(buffers); i++){
+			gl.BindBuffer(PIXEL_UNPACK_BUFFER,buffers[i]);
+			gl.BufferData(PIXEL_UNPACK_BUFFER,size,0,STREAM_DRAW);
+		}
+	}
+	if (gl.have_buffers){
+		gl.BindBuffer(PIXEL_UNPACK_BUFFER,buffers[next]);
+		gl.BufferSubData(PIXEL_UNPACK_BUFFER,0,size,pixels);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texels, height, format, GL_UNSIGNED_BYTE, 0);
+		gl.BindBuffer(PIXEL_UNPACK_BUFFER,0);
+		next = (next+1) % COUNT(buffers);
+	} else {
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texels, height, format, GL_UNSIGNED_BYTE, pixels);
+	}
+	if (unpack_program){
+		gl.UseProgram(p ? unpack_program : 0);
+		if (p){
+			gl.Uniform1f(unpack_width,(float)width);
+			gl.Uniform1f(unpack_texels,(float)texels);
+		}
 	}
 }
 
@@ -427,104 +280,126 @@ void tick(){
 uint32_t textImg[TEXT_IMG_WIDTH*TEXT_IMG_WIDTH];
 GLuint textImgTid;
 
-float gwidth,gheight;
-
-void fill(void *data){
-	int offset = data;
-	vec3 eye, ray;
-	get_player_eye_ray(eye,ray);
-	float fov = 90.0f;
-	float aspect = (float)gwidth/gheight;
-	float cam_h = 2.0f * tanf(fov * 0.5f * (float)M_PI / 180);
-	float cam_w = cam_h * aspect;
-	vec3 right;
-	vec3_cross(ray,(vec3){0,1,0},right);
-	vec3_normalize(right,right);
-	vec3 up;
-	vec3_cross(right,ray,up);
-	for (int y = offset; y < offset+25; y++){
-		for (int x = 0; x < SCREEN_WIDTH; x++){
-			float cx = ((2 * (x + 0.5f) / SCREEN_WIDTH) - 1) * cam_w;
-			float cy = ((2 * (y + 0.5f) / SCREEN_HEIGHT) - 1) * cam_h;
-			vec3 dir = {0,0,0};
-			vec3 temp;
-			vec3_scale(right,cx,dir);
-			vec3_scale(up,cy,temp);
-			vec3_add(dir,temp,dir);
-			vec3_add(dir,ray,dir);
-			vec3_scale(dir,100.0f,dir);
-			block_raycast_result_t brr;
-			cast_ray_into_blocks(eye,dir,&brr);
-			if (brr.block){
-				vec3 pos;
-				vec3_scale(dir,brr.t,dir);
-				vec3_add(eye,dir,pos);
-				for (int i = 0; i < 3; i++){
-					if (brr.face_normal[i]){
-						pos[i] += brr.face_normal[i] * 0.0001f;
-						break;
-					}
-				}
-				color_t c = {0,0,0,255};
-				for (int i = 0; i < light_count; i++){
-					vec3 light, to_light;
-					get_entity_interpolated_position(&lights[i].entity,light);
-					vec3_sub(light,pos,to_light);
-					block_raycast_result_t brr2;
-					cast_ray_into_blocks(pos,to_light,&brr2);
-					float brightness;
-					if (brr2.block){
-						brightness = 0.0f;
-					} else {
-						float len = vec3_length(to_light)/lights[i].range + 1.0f;
-						brightness = 1.0f / (len * len);
-					}
-					c.r += brightness * lights[i].color.r;
-					c.g += brightness * lights[i].color.g;
-					c.b += brightness * lights[i].color.b;
-					if (c.r > 255) c.r = 255;
-					if (c.g > 255) c.g = 255;
-					if (c.b > 255) c.b = 255;
-				}
-				screen[y*SCREEN_WIDTH+x] = c;
-			}
-		}
-	}
-}
-
 void update(double time, double deltaTime, int width, int height, int nAudioFrames, int16_t *audioSamples){
 	static bool init = false;
 	if (!init){
 		init = true;
 
-		for (int y = 0; y < WORLD_WIDTH; y++){
-			for (int z = 0; z < WORLD_WIDTH; z++){
-				for (int x = 0; x < WORLD_WIDTH; x++){
-					block_t *b = get_block(x,y,z);
-					if (
-						x > 0 && x < (WORLD_WIDTH-1) &&
-						y > 0 && y < (WORLD_WIDTH-1) &&
-						z > 0 && z < (WORLD_WIDTH-1)){
-						*b = 0;
-					} else {
-						*b = 1;
-					}
-				}
-			}
-		}
-		get_block(10,2,10)[0] = 1;
+		pool_init(0);
 
 		lock_mouse(true);
 
 		entity_set_position(&player,8,8,8);
+
+		if (record_path){
+			if (replay_record_begin(record_path)){
+				atexit(replay_record_end);
+				printf("recording input to %s\n",record_path);
+			} else {
+				printf("couldn't record input to %s\n",record_path);
+			}
+		}
+
+		//requested before anything else so it loads while the world does
+		assets_open("cache");
+		atexit(assets_close);
+		block_atlas = assets_load_image(local_path_to_absolute("textures/blocks.png"),false);
+
+		if (capture_path){
+			if (capture_begin(capture_path)){
+				atexit(capture_end);
+				printf("capturing to %s\n",capture_path);
+			} else {
+				printf("couldn't capture to %s\n",capture_path);
+			}
+		}
+
+		net.socket = -1;
+		if (join_path){
+			if (net_client_connect(&net,join_path)){
+				printf("joined %s as player %u\n",join_path,net.client);
+			} else {
+				printf("couldn't join %s, playing alone\n",join_path);
+			}
+		}
+
+		//a server's world is the generated one plus the edits it sends, nothing local goes in
+		world_open(net.socket != -1 ? 0 : "world");
+		atexit(world_close);
+		atexit(render_frame_end); //runs first, the frame in flight reads the world
+		world_load_around(player.current_position);
+
+		if (net.socket != -1){
+			sim_start_remote();
+		} else {
+			sim_start();
+			atexit(sim_stop); //runs before the world closes
+		}
+
+		shoot_sound = mixer_tone(880.0f,220.0f,0.15f,false);
+	}
+
+	uint64_t frame = profile_begin();
+	//the frame traced during the last update has to finish before the world streams. the next
+	//one is traced while this one is uploaded and presented.
+	render_frame_end();
+	static bool traced; //a frame was begun, so the one just finished is new
+	if (traced){
+		capture_frame();
 	}
 
-	accumulated_time += deltaTime;
-	while (accumulated_time >= 1.0/20.0){
-		accumulated_time -= 1.0/20.0;
-		tick();
+	//handed to the renderer between frames, it's read by the tracer
+	static bool atlas_reported;
+	if (!atlas_reported && asset_state(block_atlas) != ASSET_LOADING){
+		atlas_reported = true;
+		if (asset_state(block_atlas) == ASSET_READY){
+			printf("block atlas: %dx%d, %s in %.1f ms\n",block_atlas->width,block_atlas->height,block_atlas->cached ? "cached" : "decoded",block_atlas->load_ns / 1e6);
+			if (!render_set_atlas(block_atlas->pixels,block_atlas->width,block_atlas->height)){
+				printf("block atlas isn't 256x256, drawing untextured\n");
+			}
+		} else {
+			printf("couldn't load %s\n",block_atlas->path);
+		}
 	}
-	interpolant = accumulated_time / SEC_PER_TICK;
+
+	//the server's newest state and block edits, while no frame reads the world
+	if (net.socket != -1){
+		int n = net_client_poll(&net);
+		if (n > 0){
+			net_block_t *b = (net_block_t *)net.blocks.data;
+			for (int i = 0; i < net.blocks.count / (int)sizeof(*b); i++){
+				set_block(b[i].x,b[i].y,b[i].z,b[i].block);
+			}
+			net.blocks.count = 0;
+			sim_snapshot_t s;
+			net_client_get_snapshot(&net,&s);
+			sim_receive(&s);
+		}
+		if (n < 0 || !net_client_send_input(&net,&input,look)){
+			//carry on alone from where the server last had us rather than freezing on it
+			printf("lost the server, playing alone\n");
+			net_client_close(&net);
+			sim_stop_remote();
+			if (sim_view){
+				entity_set_position(&player,sim_view->current_position[0],sim_view->current_position[1],sim_view->current_position[2]);
+			}
+			player.head_rotation[0] = look[0];
+			player.head_rotation[1] = look[1];
+			sim_start();
+			atexit(sim_stop);
+		}
+	}
+
+	//around where the last frame saw the player. skipped while a tick is reading the world,
+	//the next frame catches up.
+	if (sim_view && sim_try_lock_world()){
+		uint64_t t = profile_begin();
+		world_update(sim_view->current_position);
+		profile_end("world update",t);
+		sim_unlock_world();
+	}
+	sim_set_input(&input,look);
+	input.just_attacked = false;
 
 	//DRAW:	
 	glViewport(0,0,width,height);
@@ -537,32 +412,38 @@ void update(double time, double deltaTime, int width, int height, int nAudioFram
 	//glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
 
-	gwidth = width;
-	gheight = height;
-	thd_thread threads[3];
-	for (int i = 0; i < 3; i++){
-		thd_thread_detach(threads+i,fill,25*(i+1));
+	uint64_t t = profile_begin();
+	render_frame_begin((float)width/height); //picks up the newest snapshot
+	traced = true;
+	profile_end("render",t);
+
+	static int heard_lights;
+	for (; heard_lights < sim_view->light_count; heard_lights++){
+		mixer_play_at(&shoot_sound,sim_view->lights[heard_lights].current_position,16.0f,0.5f);
 	}
-	fill(0);
-	for (int i = 0; i < 3; i++){
-		thd_thread_join(threads+i);
+	vec3 eye, ray, right;
+	sim_get_eye_ray(eye,ray);
+	vec3_cross(ray,(vec3){0,1,0},right);
+	vec3_normalize(right,right);
+	mixer_set_listener(eye,right);
+	t = profile_begin();
+	mixer_mix(audioSamples,nAudioFrames);
+	profile_end("mix",t);
+	if (profile_enabled){
+		draw_profile();
 	}
 
-	static GLuint texture = 0;
-	if (!texture){
-		glGenTextures(1,&texture);
-		glBindTexture(GL_TEXTURE_2D,texture);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	}
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCREEN_WIDTH, SCREEN_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, screen);
+	t = profile_begin();
+	upload_screen();
+	profile_end("upload",t);
 	int scale = 1;
-	while (SCREEN_WIDTH*scale <= width && SCREEN_HEIGHT*scale <= height){
+	while (screen_width*scale <= width && screen_height*scale <= height){
 		scale++;
 	}
 	scale--;
-	int scaledWidth = scale * SCREEN_WIDTH;
-	int scaledHeight = scale * SCREEN_HEIGHT;
+	scale = MAX(scale,1);
+	int scaledWidth = scale * screen_width;
+	int scaledHeight = scale * screen_height;
 	int x = width/2-scaledWidth/2;
 	int y = height/2-scaledHeight/2;
 	glViewport(x,y,scaledWidth,scaledHeight);
@@ -573,8 +454,29 @@ void update(double time, double deltaTime, int width, int height, int nAudioFram
 	glTexCoord2f(1,1); glVertex2f(1,1);
 	glTexCoord2f(0,1); glVertex2f(-1,1);
 	glEnd();
+	profile_end("frame",frame);
 }
 
 int main(int argc, char **argv){
+	//-r WIDTHxHEIGHT fixes the internal resolution, -t MS sets the fill time dynamic resolution aims for,
+	//-R PATH records the session's input for tinycraft_bench -L, -C PATH captures the frames for tinycraft_capture_decode,
+	//-J PATH joins the tinycraft_server listening on that socket
+	render_target_fill_ms = 8.0f;
+	profile_set_thread_name("main");
+	for (int i = 1; i+1 < argc; i += 2){
+		int w, h;
+		if (!strcmp(argv[i],"-r") && sscanf(argv[i+1],"%dx%d",&w,&h) == 2 && w > 0 && h > 0){
+			render_set_resolution(w,h);
+			render_target_fill_ms = 0;
+		} else if (!strcmp(argv[i],"-t")){
+			render_target_fill_ms = (float)atof(argv[i+1]);
+		} else if (!strcmp(argv[i],"-R")){
+			record_path = argv[i+1];
+		} else if (!strcmp(argv[i],"-C")){
+			capture_path = argv[i+1];
+		} else if (!strcmp(argv[i],"-J")){
+			join_path = argv[i+1];
+		}
+	}
     open_window(640,480);
 }
\ No newline at end of file
@@ -0,0 +1,119 @@
+#include "light_cache.h"
+
+#include <stdatomic.h>
+
+//direct mapped. an entry is one word: a 32 bit tag from the key's hash, the light's version
+//when it was traced, the visibility bits and a valid bit. the value only depends on the key
+//and the light's state, so threads racing on a slot can't make the image depend on timing.
+static _Atomic uint64_t entries[1 << LIGHT_CACHE_BITS];
+
+static struct {
+	vec3 position;
+	float reach;
+	uint32_t version;
+	bool valid;
+} tracked[LIGHT_CACHE_MAX_LIGHTS];
+
+static uint64_t mix(uint64_t h){
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdull;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ull;
+	h ^= h >> 33;
+	return h;
+}
+
+static int face_axis(block_raycast_result_t *r){
+	return r->face_normal[0] ? 0 : r->face_normal[1] ? 1 : 2;
+}
+
+//coordinates wrap at 16 bits, far more than any light reaches
+static uint64_t face_hash(block_raycast_result_t *r, int light){
+	int a = face_axis(r);
+	uint64_t key =
+		(uint64_t)(r->block_pos[0] & 0xffff) |
+		(uint64_t)(r->block_pos[1] & 0xffff) << 16 |
+		(uint64_t)(r->block_pos[2] & 0xffff) << 32 |
+		(uint64_t)(a*2 + (r->face_normal[a] > 0)) << 48 |
+		(uint64_t)light << 51;
+	return mix(key);
+}
+
+static bool box_touches_sphere(block_box_t *b, vec3 center, float radius){
+	float d2 = 0;
+	for (int i = 0; i < 3; i++){
+		float lo = (float)b->min[i], hi = (float)b->max[i] + 1.0f;
+		float d = center[i] < lo ? lo - center[i] : center[i] > hi ? center[i] - hi : 0.0f;
+		d2 += d*d;
+	}
+	return d2 <= radius*radius;
+}
+
+uint64_t light_cache_update(int count, vec3 *positions, float *reach){
+	ASSERT(count <= LIGHT_CACHE_MAX_LIGHTS);
+	uint64_t resting = 0;
+	for (int i = 0; i < LIGHT_CACHE_MAX_LIGHTS; i++){
+		if (i >= count){
+			tracked[i].valid = false;
+			continue;
+		}
+		if (tracked[i].valid && !memcmp(tracked[i].position,positions[i],sizeof(vec3))){
+			resting |= 1ull << i;
+		} else {
+			tracked[i].version++;
+			vec3_copy(positions[i],tracked[i].position);
+			tracked[i].valid = true;
+		}
+		tracked[i].reach = reach[i];
+	}
+	//a block change only matters to lights whose reach covers it. sample points sit up to
+	//a block away from the shaded pixel, hence the extra margin.
+	for (int i = 0; i < count; i++){
+		if (world_changed_everywhere){
+			tracked[i].version++;
+			continue;
+		}
+		for (int k = 0; k < world_change_count; k++){
+			if (box_touches_sphere(world_changes+k,tracked[i].position,tracked[i].reach + 2.0f)){
+				tracked[i].version++;
+				break;
+			}
+		}
+	}
+	return resting;
+}
+
+int light_cache_lookup(block_raycast_result_t *r, int light){
+	uint64_t h = face_hash(r,light);
+	uint64_t e = atomic_load_explicit(entries + (h & ((1 << LIGHT_CACHE_BITS)-1)),memory_order_relaxed);
+	if (!(e & 1) || (e >> 32) != (h >> 32) || ((e >> 8) & 0xffffff) != (tracked[light].version & 0xffffff)){
+		return -1;
+	}
+	return (e >> 4) & 15;
+}
+
+void light_cache_store(block_raycast_result_t *r, int light, int visibility){
+	uint64_t h = face_hash(r,light);
+	uint64_t e = (h >> 32) << 32 | (uint64_t)(tracked[light].version & 0xffffff) << 8 | (uint64_t)visibility << 4 | 1;
+	atomic_store_explicit(entries + (h & ((1 << LIGHT_CACHE_BITS)-1)),e,memory_order_relaxed);
+}
+
+void light_cache_sample_points(block_raycast_result_t *r, vec3 points[4]){
+	int a = face_axis(r);
+	int b = (a+1)%3, c = (a+2)%3;
+	for (int s = 0; s < 4; s++){
+		points[s][a] = (float)(r->block_pos[a] + (r->face_normal[a] > 0)) + r->face_normal[a] * 0.0001f;
+		points[s][b] = r->block_pos[b] + (s & 1 ? 0.75f : 0.25f);
+		points[s][c] = r->block_pos[c] + (s & 2 ? 0.75f : 0.25f);
+	}
+}
+
+float light_cache_visibility(block_raycast_result_t *r, vec3 p, int visibility){
+	int a = face_axis(r);
+	int b = (a+1)%3, c = (a+2)%3;
+	float u = CLAMP((p[b] - r->block_pos[b] - 0.25f) * 2.0f,0.0f,1.0f);
+	float v = CLAMP((p[c] - r->block_pos[c] - 0.25f) * 2.0f,0.0f,1.0f);
+	float top = LERP((float)(visibility & 1),(float)(visibility >> 1 & 1),u);
+	float bottom = LERP((float)(visibility >> 2 & 1),(float)(visibility >> 3 & 1),u);
+	return LERP(top,bottom,v);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "raycast.h"
+
+//visibility of every light from 4 sample points on each block face, kept across frames.
+//an entry stays valid while its light rests and nothing changes within the light's reach.
+#define LIGHT_CACHE_BITS 17
+#define LIGHT_CACHE_MAX_LIGHTS 64
+
+//once per frame before shading, with every light's position and reach for this frame.
+//reads the world's change log but leaves clearing it to the renderer.
+//returns a bit per light that hasn't moved since the previous frame and can use the cache.
+uint64_t light_cache_update(int count, vec3 *positions, float *reach);
+
+//4 bit visibility of the light from the face hit by r, or -1 if it isn't cached.
+int light_cache_lookup(block_raycast_result_t *r, int light);
+void light_cache_store(block_raycast_result_t *r, int light, int visibility);
+
+//shadow ray origins, just off the face, for the 4 visibility bits.
+void light_cache_sample_points(block_raycast_result_t *r, vec3 points[4]);
+
+//blends the 4 sample visibilities at point p on the face hit by r.
+float light_cache_visibility(block_raycast_result_t *r, vec3 p, int visibility);
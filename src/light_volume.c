@@ -0,0 +1,217 @@
+#include "light_volume.h"
+#include "profile.h"
+
+//a light's level in a channel is how far that channel carries before it drops below the cutoff
+//the shadow rays use. a level only says how much reach is left, not which light it came from,
+//so brightness is read back along the falloff of a full brightness light of LIGHT_VOLUME_RANGE,
+//the range shoot_light gives every light. others come out somewhat off.
+#define LIGHT_VOLUME_CUTOFF 16.0f
+#define LIGHT_VOLUME_RANGE 8.0f
+
+static float level_brightness[LIGHT_LEVEL_MAX+1];
+
+typedef struct {
+	int x, y, z;
+	int level; //the cell's when it was taken out, unused for fills
+} queued_cell_t;
+
+typedef struct {
+	queued_cell_t *cells;
+	int count, capacity;
+} cell_queue_t;
+
+//the removal flood is a stack, the fill a queue, both only grow
+static cell_queue_t removals, fills;
+
+static struct {
+	ivec3 cell;
+	uint8_t level[3];
+	bool lit; //false if its cell was solid or not resident
+} seeded[MAX_LIGHTS];
+static int seeded_count;
+static bool current;
+
+static void push(cell_queue_t *q, int x, int y, int z, int level){
+	if (q->count == q->capacity){
+		q->capacity = q->capacity ? q->capacity*2 : 4096;
+		q->cells = realloc(q->cells,q->capacity*sizeof(*q->cells));
+		ASSERT(q->cells);
+	}
+	q->cells[q->count++] = (queued_cell_t){x,y,z,level};
+}
+
+//0 for solid cells and cells outside resident chunks, light never enters those
+static uint8_t *open_cell(int x, int y, int z, int channel){
+	chunk_t *c = get_chunk(x >> CHUNK_SHIFT,y >> CHUNK_SHIFT,z >> CHUNK_SHIFT);
+	if (!c){
+		return 0;
+	}
+	int i = chunk_block_index(x,y,z);
+	return c->blocks[i] ? 0 : c->light[channel] + i;
+}
+
+static const int neighbors[6][3] = {{-1,0,0},{1,0,0},{0,-1,0},{0,1,0},{0,0,-1},{0,0,1}};
+
+//takes out everything downstream of the queued cells. neighbors at least as bright were lit
+//some other way and fill the hole back in.
+static void drain_removals(int channel){
+	while (removals.count){
+		queued_cell_t q = removals.cells[--removals.count];
+		for (int n = 0; n < 6; n++){
+			int x = q.x + neighbors[n][0], y = q.y + neighbors[n][1], z = q.z + neighbors[n][2];
+			uint8_t *l = open_cell(x,y,z,channel);
+			if (!l || !*l){
+				continue;
+			}
+			if (*l < q.level){
+				push(&removals,x,y,z,*l);
+				*l = 0;
+			} else {
+				push(&fills,x,y,z,0);
+			}
+		}
+	}
+}
+
+static void drain_fills(int channel){
+	for (int head = 0; head < fills.count; head++){
+		queued_cell_t q = fills.cells[head];
+		uint8_t *from = open_cell(q.x,q.y,q.z,channel);
+		if (!from || *from <= 1){
+			continue;
+		}
+		int level = *from - 1;
+		for (int n = 0; n < 6; n++){
+			int x = q.x + neighbors[n][0], y = q.y + neighbors[n][1], z = q.z + neighbors[n][2];
+			uint8_t *l = open_cell(x,y,z,channel);
+			if (l && *l < level){
+				*l = (uint8_t)level;
+				push(&fills,x,y,z,0);
+			}
+		}
+	}
+	fills.count = 0;
+}
+
+static void remove_cell(int x, int y, int z, int channel){
+	chunk_t *c = get_chunk(x >> CHUNK_SHIFT,y >> CHUNK_SHIFT,z >> CHUNK_SHIFT);
+	if (!c){
+		return;
+	}
+	uint8_t *l = c->light[channel] + chunk_block_index(x,y,z);
+	if (*l){
+		push(&removals,x,y,z,*l);
+		*l = 0;
+	}
+}
+
+//light that passed through the box may be wrong now, and so may the light of cells just
+//outside, lit through it. removing both lets the fill work out the box's new light from the rest.
+static void remove_box(block_box_t *b, int channel){
+	for (int y = b->min[1]-1; y <= b->max[1]+1; y++){
+		for (int z = b->min[2]-1; z <= b->max[2]+1; z++){
+			for (int x = b->min[0]-1; x <= b->max[0]+1; x++){
+				remove_cell(x,y,z,channel);
+			}
+		}
+	}
+}
+
+static void clear_all(void){
+	for (int i = 0; i < COUNT(chunk_index); i++){
+		chunk_t *c = chunk_index[i];
+		if (c && c->ready){
+			memset(c->light,0,sizeof(c->light));
+		}
+	}
+}
+
+void light_volume_invalidate(void){
+	current = false;
+}
+
+void light_volume_update(int count, vec3 *positions, color_t *colors, float *ranges){
+	ASSERT(count <= MAX_LIGHTS);
+	uint64_t t = profile_begin();
+	if (!level_brightness[1]){
+		for (int l = 1; l <= LIGHT_LEVEL_MAX; l++){
+			float f = (LIGHT_LEVEL_MAX + LIGHT_VOLUME_RANGE) / (LIGHT_LEVEL_MAX + LIGHT_VOLUME_RANGE - l);
+			level_brightness[l] = LIGHT_VOLUME_CUTOFF * f*f;
+		}
+	}
+	//a full log has merged everything past it into one box, filling in from scratch is cheaper
+	bool rebuild = !current || world_changed_everywhere || world_change_count == WORLD_CHANGE_LOG;
+	if (rebuild){
+		clear_all();
+		seeded_count = 0;
+		current = true;
+	}
+
+	struct {
+		ivec3 cell;
+		uint8_t level[3];
+	} next[MAX_LIGHTS];
+	for (int i = 0; i < count; i++){
+		uint8_t channels[3] = {colors[i].r,colors[i].g,colors[i].b};
+		for (int k = 0; k < 3; k++){
+			next[i].cell[k] = (int)floorf(positions[i][k]);
+			float reach = channels[k] >= LIGHT_VOLUME_CUTOFF ? ranges[i] * (sqrtf(channels[k] / LIGHT_VOLUME_CUTOFF) - 1.0f) : 0.0f;
+			next[i].level[k] = (uint8_t)MIN(LIGHT_LEVEL_MAX,(int)roundf(reach));
+		}
+	}
+
+	for (int channel = 0; channel < 3; channel++){
+		//a light that moved or went away is taken out where it was, unless something brighter
+		//shares its cell, then it isn't the brightest anywhere
+		for (int i = 0; i < seeded_count; i++){
+			if (!seeded[i].lit || (i < count && !memcmp(seeded[i].cell,next[i].cell,sizeof(ivec3)) && !memcmp(seeded[i].level,next[i].level,3))){
+				continue;
+			}
+			int *p = seeded[i].cell;
+			uint8_t *l = open_cell(p[0],p[1],p[2],channel);
+			if (l && *l && *l == seeded[i].level[channel]){
+				push(&removals,p[0],p[1],p[2],*l);
+				*l = 0;
+			}
+		}
+		for (int i = 0; i < world_change_count && !rebuild; i++){
+			remove_box(world_changes+i,channel);
+		}
+		drain_removals(channel);
+
+		//every light is seeded again, the removals may have taken out cells another one lit
+		for (int i = 0; i < count; i++){
+			int *p = next[i].cell;
+			uint8_t *l = open_cell(p[0],p[1],p[2],channel);
+			if (l && *l < next[i].level[channel]){
+				*l = next[i].level[channel];
+				push(&fills,p[0],p[1],p[2],0);
+			}
+		}
+		drain_fills(channel);
+	}
+
+	for (int i = 0; i < count; i++){
+		memcpy(seeded[i].cell,next[i].cell,sizeof(ivec3));
+		memcpy(seeded[i].level,next[i].level,3);
+		seeded[i].lit = open_cell(next[i].cell[0],next[i].cell[1],next[i].cell[2],0) != 0;
+	}
+	seeded_count = count;
+	profile_end("light volume",t);
+}
+
+hdr_color_t light_volume_shade(block_raycast_result_t *r){
+	int x = r->block_pos[0] + r->face_normal[0];
+	int y = r->block_pos[1] + r->face_normal[1];
+	int z = r->block_pos[2] + r->face_normal[2];
+	chunk_t *c = get_chunk(x >> CHUNK_SHIFT,y >> CHUNK_SHIFT,z >> CHUNK_SHIFT);
+	if (!c){
+		return (hdr_color_t){0};
+	}
+	int i = chunk_block_index(x,y,z);
+	return (hdr_color_t){
+		.r = level_brightness[c->light[0][i]],
+		.g = level_brightness[c->light[1][i]],
+		.b = level_brightness[c->light[2][i]],
+	};
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "raycast.h"
+#include "tonemap.h"
+
+//block light, the cheap alternative to shadow rays. every air cell keeps a level per color
+//channel, the blocks of reach a light has left there, flood filled out of the lights one block
+//at a time and stopped by solid blocks. where lights overlap a cell keeps the strongest.
+//a light that moves and a box of blocks that changed are taken out by a second flood through
+//everything they lit, and the light around them is filled back in, so an update only costs
+//what it touches.
+#define LIGHT_LEVEL_MAX 24
+
+//once per frame before shading, with every light's position, color and range for this frame.
+//reads the world's change log but leaves clearing it to the renderer.
+void light_volume_update(int count, vec3 *positions, color_t *colors, float *ranges);
+void light_volume_invalidate(void); //the next update fills everything in from scratch
+
+//the light on the face hit by r, from the cell in front of it
+hdr_color_t light_volume_shade(block_raycast_result_t *r);
@@ -0,0 +1,172 @@
+#include "mixer.h"
+
+#define MIX_CHUNK 256 //frames summed in floats at a time
+
+typedef struct {
+	sound_t *sound;
+	int position; //next frame of the sound
+	int generation; //bumped whenever the voice is reused, so old handles go stale
+	bool positional;
+	vec3 source;
+	float range, volume;
+	float gain[2]; //left and right at the end of the last mix, where the next ramp starts
+	bool started;
+} voice_t;
+
+static voice_t voices[MIXER_VOICES];
+static vec3 listener, listener_right = {1,0,0};
+
+sound_t mixer_tone(float start_hz, float end_hz, float seconds, bool loop){
+	sound_t s = {.frames = MAX(1,(int)(seconds * TINY3D_SAMPLE_RATE)), .loop = loop};
+	s.samples = malloc(s.frames*sizeof(*s.samples));
+	ASSERT(s.samples);
+	int fade = MIN(s.frames/2,TINY3D_SAMPLE_RATE/200);
+	double phase = 0;
+	for (int i = 0; i < s.frames; i++){
+		double hz = LERP(start_hz,end_hz,(double)i / s.frames);
+		float envelope = 1.0f;
+		if (!loop && fade){
+			envelope = MIN(1.0f,MIN(i,s.frames-1-i) / (float)fade);
+		}
+		s.samples[i] = (float)sin(phase) * envelope;
+		phase += 2 * M_PI * hz / TINY3D_SAMPLE_RATE;
+	}
+	return s;
+}
+
+static int handle(int index){
+	return voices[index].generation * MIXER_VOICES + index;
+}
+
+static voice_t *get_voice(int voice){
+	if (voice < 0){
+		return 0;
+	}
+	voice_t *v = voices + voice % MIXER_VOICES;
+	return v->sound && v->generation == voice / MIXER_VOICES ? v : 0;
+}
+
+static int start_voice(sound_t *s, float volume, bool positional, vec3 position, float range){
+	for (int i = 0; i < MIXER_VOICES; i++){
+		voice_t *v = voices+i;
+		if (!v->sound){
+			int generation = v->generation + 1;
+			*v = (voice_t){
+				.sound = s,
+				.generation = generation,
+				.positional = positional,
+				.range = range,
+				.volume = volume,
+			};
+			if (positional){
+				vec3_copy(position,v->source);
+			}
+			return handle(i);
+		}
+	}
+	return -1;
+}
+
+int mixer_play(sound_t *s, float volume){
+	return start_voice(s,volume,false,0,0);
+}
+
+int mixer_play_at(sound_t *s, vec3 position, float range, float volume){
+	return start_voice(s,volume,true,position,range);
+}
+
+void mixer_move(int voice, vec3 position){
+	voice_t *v = get_voice(voice);
+	if (v && v->positional){
+		vec3_copy(position,v->source);
+	}
+}
+
+void mixer_stop(int voice){
+	voice_t *v = get_voice(voice);
+	if (v){
+		v->sound = 0;
+	}
+}
+
+int mixer_voice_count(void){
+	int count = 0;
+	for (int i = 0; i < MIXER_VOICES; i++){
+		count += voices[i].sound != 0;
+	}
+	return count;
+}
+
+void mixer_set_listener(vec3 position, vec3 right){
+	vec3_copy(position,listener);
+	vec3_copy(right,listener_right);
+}
+
+//constant power pan by how far to the side the source is, and the lights' 1/(d/range+1)^2 falloff
+static void target_gain(voice_t *v, float gain[2]){
+	float volume = v->volume, pan = 0.0f;
+	if (v->positional){
+		vec3 d;
+		vec3_sub(v->source,listener,d);
+		float dist = vec3_length(d);
+		float f = dist / v->range + 1.0f;
+		volume /= f*f;
+		if (dist > 0.0f){
+			pan = CLAMP(vec3_dot(d,listener_right) / dist,-1.0f,1.0f);
+		}
+	}
+	float angle = (pan + 1.0f) * (float)M_PI / 4;
+	gain[0] = volume * cosf(angle);
+	gain[1] = volume * sinf(angle);
+}
+
+void mixer_mix(int16_t *out, int frames){
+	float gain[MIXER_VOICES][2], step[MIXER_VOICES][2];
+	for (int i = 0; i < MIXER_VOICES; i++){
+		voice_t *v = voices+i;
+		if (!v->sound){
+			continue;
+		}
+		float target[2];
+		target_gain(v,target);
+		if (!v->started){
+			v->gain[0] = target[0];
+			v->gain[1] = target[1];
+			v->started = true;
+		}
+		for (int c = 0; c < 2; c++){
+			gain[i][c] = v->gain[c];
+			step[i][c] = frames ? (target[c] - v->gain[c]) / frames : 0.0f;
+			v->gain[c] = target[c];
+		}
+	}
+	for (int f0 = 0; f0 < frames; f0 += MIX_CHUNK){
+		int n = MIN(MIX_CHUNK,frames-f0);
+		float mix[MIX_CHUNK][2] = {0};
+		for (int i = 0; i < MIXER_VOICES; i++){
+			voice_t *v = voices+i;
+			if (!v->sound){
+				continue;
+			}
+			for (int f = 0; f < n; f++){
+				float s = v->sound->samples[v->position];
+				mix[f][0] += s * gain[i][0];
+				mix[f][1] += s * gain[i][1];
+				gain[i][0] += step[i][0];
+				gain[i][1] += step[i][1];
+				if (++v->position == v->sound->frames){
+					v->position = 0;
+					if (!v->sound->loop){
+						v->sound = 0;
+						break;
+					}
+				}
+			}
+		}
+		for (int f = 0; f < n; f++){
+			for (int c = 0; c < 2; c++){
+				out[(f0+f)*2+c] = (int16_t)CLAMP(lrintf(mix[f][c] * 32767.0f),-32768,32767);
+			}
+		}
+	}
+}
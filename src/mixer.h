@@ -0,0 +1,31 @@
+#pragma once
+
+#include "tiny3d.h"
+
+//sound mixer for the stereo frames update() is handed. it lives entirely on the thread that
+//calls it: the game plays and moves voices, mixer_mix renders them, and nothing ever waits.
+#define MIXER_VOICES 32
+
+typedef struct {
+	float *samples; //mono, -1 to 1, at TINY3D_SAMPLE_RATE
+	int frames;
+	bool loop;
+} sound_t;
+
+//a sine sweep from one frequency to another with a short fade in and out, looped or not
+sound_t mixer_tone(float start_hz, float end_hz, float seconds, bool loop);
+
+//returns a voice handle, or -1 when every voice is busy. handles of finished voices go stale,
+//and the calls below ignore stale handles.
+int mixer_play(sound_t *s, float volume);
+//positional voices fade with distance the way lights do and pan to the side they are on
+int mixer_play_at(sound_t *s, vec3 position, float range, float volume);
+void mixer_move(int voice, vec3 position);
+void mixer_stop(int voice);
+int mixer_voice_count(void); //voices playing
+
+void mixer_set_listener(vec3 position, vec3 right);
+
+//renders frames interleaved stereo frames into out, overwriting it.
+//gains are worked out once per call and ramped across it, so moving sources don't click.
+void mixer_mix(int16_t *out, int frames);
@@ -0,0 +1,523 @@
+#include "net.h"
+#include "replay.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+void net_buffer_append(net_buffer_t *b, void *data, int size){
+	if (b->count + size > b->capacity){
+		b->capacity = MAX(b->count + size,b->capacity ? b->capacity*2 : 4096);
+		b->data = realloc(b->data,b->capacity);
+		ASSERT(b->data);
+	}
+	memcpy(b->data + b->count,data,size);
+	b->count += size;
+}
+
+void net_buffer_consume(net_buffer_t *b, int size){
+	memmove(b->data,b->data + size,b->count - size);
+	b->count -= size;
+}
+
+static void put_u8(net_buffer_t *b, uint8_t v){
+	net_buffer_append(b,&v,1);
+}
+
+static void put_varint(net_buffer_t *b, int32_t v){
+	uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+	while (z >= 0x80){
+		put_u8(b,(uint8_t)(z | 0x80));
+		z >>= 7;
+	}
+	put_u8(b,(uint8_t)z);
+}
+
+//reads from a payload, running past its end sets failed and reads zeros
+typedef struct {
+	uint8_t *data;
+	int size, at;
+	bool failed;
+} reader_t;
+
+static void get(reader_t *r, void *out, int size){
+	if (r->size - r->at < size){
+		r->failed = true;
+		memset(out,0,size);
+		return;
+	}
+	memcpy(out,r->data + r->at,size);
+	r->at += size;
+}
+
+static int32_t get_varint(reader_t *r){
+	uint32_t z = 0;
+	for (int shift = 0; shift < 35; shift += 7){
+		uint8_t b;
+		get(r,&b,1);
+		z |= (uint32_t)(b & 0x7f) << shift;
+		if (!(b & 0x80)){
+			return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+		}
+	}
+	r->failed = true;
+	return 0;
+}
+
+static void quantize_position(vec3 p, int32_t *out){
+	for (int i = 0; i < 3; i++){
+		out[i] = (int32_t)roundf(p[i] * NET_POSITION_SCALE);
+	}
+}
+
+void net_state_set_player(net_state_t *s, int id, entity_t *p){
+	net_entity_t *e = s->entities + id;
+	memset(e,0,sizeof(*e));
+	if (!p){
+		return;
+	}
+	e->kind = NET_ENTITY_PLAYER;
+	quantize_position(p->current_position,e->position);
+	float yaw = fmodf(p->head_rotation[1],360.0f);
+	e->rotation[0] = (int16_t)roundf(p->head_rotation[0] * NET_ROTATION_SCALE);
+	e->rotation[1] = (int16_t)roundf((yaw < 0 ? yaw + 360.0f : yaw) * NET_ROTATION_SCALE);
+}
+
+void net_state_set_lights(net_state_t *s){
+	for (int i = 0; i < MAX_LIGHTS; i++){
+		net_entity_t *e = s->entities + NET_MAX_CLIENTS + i;
+		memset(e,0,sizeof(*e));
+		if (i < light_count){
+			e->kind = NET_ENTITY_LIGHT;
+			quantize_position(entities.current_position[lights[i].entity],e->position);
+			e->color = lights[i].color;
+			e->range = (uint16_t)MIN(65535,(int)(lights[i].range * 256.0f));
+		}
+	}
+}
+
+void net_encode_snapshot(net_buffer_t *out, net_state_t *state, net_state_t *baseline, uint32_t tick_ns, net_block_t *blocks, int block_count){
+	static net_entity_t none;
+	int start = out->count;
+	net_header_t h = {.type = NET_SNAPSHOT};
+	net_snapshot_header_t s = {
+		.tick = state->tick,
+		.baseline = baseline ? baseline->tick : 0,
+		.tick_ns = tick_ns,
+		.block_count = (uint32_t)block_count,
+	};
+	net_buffer_append(out,&h,sizeof(h));
+	net_buffer_append(out,&s,sizeof(s));
+	for (int id = 0; id < NET_ENTITIES; id++){
+		net_entity_t *e = state->entities + id;
+		net_entity_t *b = baseline ? baseline->entities + id : &none;
+		if (!e->kind){
+			continue;
+		}
+		uint8_t mask = 0;
+		for (int i = 0; i < 3; i++){
+			mask |= e->position[i] != b->position[i] ? NET_CHANGED_X << i : 0;
+		}
+		mask |= memcmp(e->rotation,b->rotation,sizeof(e->rotation)) ? NET_CHANGED_ROTATION : 0;
+		mask |= e->kind != b->kind || memcmp(&e->color,&b->color,sizeof(e->color)) || e->range != b->range ? NET_CHANGED_LOOK : 0;
+		if (!mask){
+			continue;
+		}
+		uint16_t id16 = (uint16_t)id;
+		net_buffer_append(out,&id16,sizeof(id16));
+		put_u8(out,mask);
+		//ids not in use are all zeros, so a new entity's deltas are against 0
+		for (int i = 0; i < 3; i++){
+			if (mask & (NET_CHANGED_X << i)){
+				put_varint(out,e->position[i] - b->position[i]);
+			}
+		}
+		if (mask & NET_CHANGED_ROTATION){
+			net_buffer_append(out,e->rotation,sizeof(e->rotation));
+		}
+		if (mask & NET_CHANGED_LOOK){
+			put_u8(out,e->kind);
+			net_buffer_append(out,&e->color,sizeof(e->color));
+			net_buffer_append(out,&e->range,sizeof(e->range));
+		}
+		s.entity_count++;
+	}
+	for (int id = 0; baseline && id < NET_ENTITIES; id++){
+		if (baseline->entities[id].kind && !state->entities[id].kind){
+			uint16_t id16 = (uint16_t)id;
+			net_buffer_append(out,&id16,sizeof(id16));
+			s.removed_count++;
+		}
+	}
+	for (int i = 0; i < block_count; i++){
+		net_buffer_append(out,&blocks[i].x,3*sizeof(int32_t));
+		put_u8(out,blocks[i].block);
+	}
+	h.size = (uint32_t)(out->count - start - sizeof(h));
+	memcpy(out->data + start,&h,sizeof(h));
+	memcpy(out->data + start + sizeof(h),&s,sizeof(s));
+}
+
+bool net_apply_snapshot(net_state_t *state, uint8_t *payload, int size, net_buffer_t *blocks, uint32_t *tick_ns){
+	reader_t r = {.data = payload, .size = size};
+	net_snapshot_header_t s;
+	get(&r,&s,sizeof(s));
+	if (r.failed || !s.tick || (s.baseline && s.baseline != state->tick)){
+		return false;
+	}
+	if (!s.baseline){
+		memset(state->entities,0,sizeof(state->entities));
+	}
+	for (int k = 0; k < s.entity_count; k++){
+		uint16_t id;
+		uint8_t mask;
+		get(&r,&id,sizeof(id));
+		get(&r,&mask,1);
+		if (id >= NET_ENTITIES){
+			return false;
+		}
+		net_entity_t *e = state->entities + id;
+		if (!e->kind){
+			memset(e,0,sizeof(*e));
+			if (!(mask & NET_CHANGED_LOOK)){
+				return false;
+			}
+		}
+		for (int i = 0; i < 3; i++){
+			if (mask & (NET_CHANGED_X << i)){
+				e->position[i] += get_varint(&r);
+			}
+		}
+		if (mask & NET_CHANGED_ROTATION){
+			get(&r,e->rotation,sizeof(e->rotation));
+		}
+		if (mask & NET_CHANGED_LOOK){
+			get(&r,&e->kind,1);
+			get(&r,&e->color,sizeof(e->color));
+			get(&r,&e->range,sizeof(e->range));
+		}
+	}
+	for (int k = 0; k < s.removed_count; k++){
+		uint16_t id;
+		get(&r,&id,sizeof(id));
+		if (id >= NET_ENTITIES){
+			return false;
+		}
+		state->entities[id].kind = 0;
+	}
+	for (uint32_t k = 0; k < s.block_count && !r.failed; k++){
+		net_block_t b = {.tick = s.tick};
+		get(&r,&b.x,3*sizeof(int32_t));
+		get(&r,&b.block,1);
+		net_buffer_append(blocks,&b,sizeof(b));
+	}
+	if (r.failed || r.at != size){
+		return false;
+	}
+	state->tick = s.tick;
+	*tick_ns = s.tick_ns;
+	return true;
+}
+
+#ifdef _WIN32
+
+int net_listen(char *path){
+	return -1;
+}
+
+int net_accept(int listener){
+	return -1;
+}
+
+int net_send(int socket, void *data, int size){
+	return -1;
+}
+
+int net_receive(int socket, net_buffer_t *b){
+	return -1;
+}
+
+void net_close(int socket){
+}
+
+bool net_client_connect(net_client_t *c, char *path){
+	memset(c,0,sizeof(*c));
+	c->socket = -1;
+	return false;
+}
+
+#else
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 //the caller ignores SIGPIPE instead
+#endif
+
+static bool set_nonblocking(int s){
+	int flags = fcntl(s,F_GETFL);
+	return flags != -1 && fcntl(s,F_SETFL,flags | O_NONBLOCK) != -1;
+}
+
+static bool make_address(char *path, struct sockaddr_un *a){
+	memset(a,0,sizeof(*a));
+	a->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(a->sun_path)){
+		return false;
+	}
+	strcpy(a->sun_path,path);
+	return true;
+}
+
+int net_listen(char *path){
+	struct sockaddr_un a;
+	if (!make_address(path,&a)){
+		return -1;
+	}
+	int s = socket(AF_UNIX,SOCK_STREAM,0);
+	if (s == -1){
+		return -1;
+	}
+	unlink(path);
+	if (bind(s,(struct sockaddr *)&a,sizeof(a)) || listen(s,SOMAXCONN) || !set_nonblocking(s)){
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+int net_accept(int listener){
+	int s = accept(listener,0,0);
+	if (s != -1 && !set_nonblocking(s)){
+		close(s);
+		return -1;
+	}
+	return s;
+}
+
+int net_send(int socket, void *data, int size){
+	ssize_t n = send(socket,data,size,MSG_NOSIGNAL);
+	if (n < 0){
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+	}
+	return (int)n;
+}
+
+int net_receive(int socket, net_buffer_t *b){
+	int total = 0;
+	for (;;){
+		if (b->capacity - b->count < 4096){
+			b->capacity = MAX(b->capacity*2,b->count + 65536);
+			b->data = realloc(b->data,b->capacity);
+			ASSERT(b->data);
+		}
+		ssize_t n = recv(socket,b->data + b->count,b->capacity - b->count,0);
+		if (n > 0){
+			b->count += (int)n;
+			total += (int)n;
+		} else if (n < 0 && errno == EINTR){
+			continue;
+		} else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+			return total;
+		} else {
+			return -1;
+		}
+	}
+}
+
+void net_close(int socket){
+	if (socket != -1){
+		close(socket);
+	}
+}
+
+//everything, waiting for room as long as it takes
+static bool send_all(int socket, void *data, int size){
+	uint8_t *p = data;
+	while (size){
+		int n = net_send(socket,p,size);
+		if (n < 0){
+			return false;
+		}
+		if (!n){
+			poll(&(struct pollfd){.fd = socket, .events = POLLOUT},1,100);
+		}
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+bool net_client_connect(net_client_t *c, char *path){
+	memset(c,0,sizeof(*c));
+	c->socket = -1;
+	struct sockaddr_un a;
+	if (!make_address(path,&a)){
+		return false;
+	}
+	int s = socket(AF_UNIX,SOCK_STREAM,0);
+	if (s == -1){
+		return false;
+	}
+	if (connect(s,(struct sockaddr *)&a,sizeof(a)) || !set_nonblocking(s)){
+		close(s);
+		return false;
+	}
+	c->socket = s;
+	struct {
+		net_header_t h;
+		net_hello_t hello;
+	} m = {{NET_HELLO,sizeof(net_hello_t)},{NET_VERSION}};
+	if (!send_all(s,&m,sizeof(m))){
+		net_client_close(c);
+		return false;
+	}
+	//the welcome is the first thing the server sends
+	uint64_t give_up = get_time() + 5000000000ull;
+	for (;;){
+		if (get_time() > give_up || net_receive(s,&c->in) < 0){
+			net_client_close(c);
+			return false;
+		}
+		if (c->in.count >= (int)(sizeof(net_header_t) + sizeof(net_welcome_t))){
+			break;
+		}
+		poll(&(struct pollfd){.fd = s, .events = POLLIN},1,100);
+	}
+	net_header_t h;
+	net_welcome_t w;
+	memcpy(&h,c->in.data,sizeof(h));
+	memcpy(&w,c->in.data + sizeof(h),sizeof(w));
+	if (h.type != NET_WELCOME || h.size != sizeof(w) || w.version != NET_VERSION || w.client >= NET_MAX_CLIENTS){
+		net_client_close(c);
+		return false;
+	}
+	net_buffer_consume(&c->in,sizeof(h) + sizeof(w));
+	c->client = w.client;
+	return true;
+}
+
+#endif
+
+void net_client_close(net_client_t *c){
+	net_close(c->socket);
+	c->socket = -1;
+	free(c->in.data);
+	free(c->out.data);
+	free(c->blocks.data);
+	memset(&c->in,0,sizeof(c->in));
+	memset(&c->out,0,sizeof(c->out));
+	memset(&c->blocks,0,sizeof(c->blocks));
+}
+
+//what didn't go out before stays queued for the next call
+static bool flush(net_client_t *c){
+	while (c->out.count){
+		int n = net_send(c->socket,c->out.data,c->out.count);
+		if (n < 0){
+			return false;
+		}
+		if (!n){
+			break;
+		}
+		net_buffer_consume(&c->out,n);
+	}
+	return true;
+}
+
+bool net_client_send_input(net_client_t *c, keys_t *k, vec2 head_rotation){
+	if (c->socket == -1){
+		return false;
+	}
+	net_input_t in = {
+		.pitch = head_rotation[0],
+		.yaw = head_rotation[1],
+		.input =
+			(k->left ? REPLAY_LEFT : 0) |
+			(k->right ? REPLAY_RIGHT : 0) |
+			(k->backward ? REPLAY_BACKWARD : 0) |
+			(k->forward ? REPLAY_FORWARD : 0) |
+			(k->jump ? REPLAY_JUMP : 0),
+		.shots = c->input.shots + k->just_attacked,
+	};
+	if (memcmp(&in,&c->input,sizeof(in))){
+		c->input = in;
+		net_header_t h = {NET_INPUT,sizeof(in)};
+		net_buffer_append(&c->out,&h,sizeof(h));
+		net_buffer_append(&c->out,&in,sizeof(in));
+	}
+	if (!flush(c)){
+		net_client_close(c);
+		return false;
+	}
+	return true;
+}
+
+int net_client_poll(net_client_t *c){
+	if (c->socket == -1){
+		return -1;
+	}
+	int n = net_receive(c->socket,&c->in);
+	if (n < 0){
+		net_client_close(c);
+		return -1;
+	}
+	c->bytes_received += n;
+	int applied = 0;
+	int at = 0;
+	while (c->in.count - at >= (int)sizeof(net_header_t)){
+		net_header_t h;
+		memcpy(&h,c->in.data + at,sizeof(h));
+		if (h.size > NET_MAX_MESSAGE || h.type != NET_SNAPSHOT){
+			net_client_close(c);
+			return -1;
+		}
+		if (c->in.count - at - (int)sizeof(h) < (int)h.size){
+			break;
+		}
+		c->previous = c->state;
+		if (!net_apply_snapshot(&c->state,c->in.data + at + sizeof(h),h.size,&c->blocks,&c->server_tick_ns)){
+			net_client_close(c);
+			return -1;
+		}
+		c->time = get_time();
+		c->snapshots++;
+		applied++;
+		at += sizeof(h) + h.size;
+	}
+	net_buffer_consume(&c->in,at);
+	return applied;
+}
+
+static void dequantize_position(int32_t *p, vec3 out){
+	for (int i = 0; i < 3; i++){
+		out[i] = p[i] / NET_POSITION_SCALE;
+	}
+}
+
+void net_client_get_snapshot(net_client_t *c, sim_snapshot_t *s){
+	memset(s,0,sizeof(*s));
+	s->tick = c->state.tick;
+	s->time = c->time;
+	net_entity_t *me = c->state.entities + c->client;
+	net_entity_t *was = c->previous.entities + c->client;
+	dequantize_position(me->position,s->current_position);
+	dequantize_position(was->kind ? was->position : me->position,s->previous_position);
+	s->head_rotation[0] = me->rotation[0] / NET_ROTATION_SCALE;
+	s->head_rotation[1] = me->rotation[1] / NET_ROTATION_SCALE;
+	for (int i = 0; i < MAX_LIGHTS; i++){
+		net_entity_t *e = c->state.entities + NET_MAX_CLIENTS + i;
+		net_entity_t *p = c->previous.entities + NET_MAX_CLIENTS + i;
+		if (e->kind != NET_ENTITY_LIGHT){
+			continue;
+		}
+		light_snapshot_t *l = s->lights + s->light_count++;
+		dequantize_position(e->position,l->current_position);
+		dequantize_position(p->kind ? p->position : e->position,l->previous_position);
+		l->color = e->color;
+		l->range = e->range / 256.0f;
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "sim.h"
+#include "world.h"
+
+//networked play over a local socket. a headless server (tools/server.c) runs the sim for every
+//connected player and sends each client a snapshot per tick, a delta against the last one that
+//client was sent: entities that didn't change cost nothing, and positions that did cost a byte
+//or two per axis. block edits ride along with the snapshots. clients send their input whenever
+//it changes and render the snapshots through sim_receive like ones from the sim thread.
+//everything is little endian, as it's only ever spoken to the same machine.
+#define NET_VERSION 1
+#define NET_MAX_CLIENTS 256
+#define NET_ENTITIES (NET_MAX_CLIENTS + MAX_LIGHTS) //players by client, then lights by index
+#define NET_HISTORY 32 //ticks the server keeps to delta against, a power of two
+#define NET_POSITION_SCALE 1024.0f //fixed point steps per block
+#define NET_ROTATION_SCALE 64.0f //per degree
+
+enum {
+	NET_HELLO = 1, //client, net_hello_t
+	NET_WELCOME, //server, net_welcome_t
+	NET_INPUT, //client, net_input_t
+	NET_SNAPSHOT, //server, net_snapshot_header_t and its entries
+};
+
+//every message is this header and size bytes after it
+typedef struct {
+	uint32_t type;
+	uint32_t size;
+} net_header_t;
+#define NET_MAX_MESSAGE (16 << 20) //a snapshot from scratch carries every block edit so far
+
+typedef struct {
+	uint32_t version;
+} net_hello_t;
+
+typedef struct {
+	uint32_t version; //a client that speaks another one is hung up on after this
+	uint32_t client; //the entity id of the client's player
+} net_welcome_t;
+
+typedef struct {
+	float pitch, yaw;
+	uint32_t input; //REPLAY_* bits, REPLAY_SHOOT unused
+	uint32_t shots; //clicks so far, a tick that sees it go up shoots one light
+} net_input_t;
+
+enum {
+	NET_ENTITY_PLAYER = 1,
+	NET_ENTITY_LIGHT,
+};
+
+typedef struct {
+	uint8_t kind; //NET_ENTITY_*, 0 for an id that isn't in use
+	int32_t position[3]; //in 1/NET_POSITION_SCALE blocks
+	int16_t rotation[2]; //pitch and yaw in 1/NET_ROTATION_SCALE degrees, players
+	color_t color; //lights
+	uint16_t range; //in 1/256 blocks, lights
+} net_entity_t;
+
+//a tick of the server's state as the clients see it, indexed by entity id
+typedef struct {
+	uint32_t tick; //0 is never a tick, it stands for nothing to delta against
+	net_entity_t entities[NET_ENTITIES];
+} net_state_t;
+
+typedef struct {
+	int32_t x, y, z;
+	block_t block;
+	uint32_t tick; //the server's tick it was made in
+} net_block_t;
+
+//after it, entity_count entries of a uint16_t id, a uint8_t mask of NET_CHANGED_* bits and the
+//fields the mask names: zigzag varints for position axes, against the baseline or 0 for new
+//entities, int16_t pitch and yaw, and kind, color and range as uint8_t, color_t and uint16_t.
+//then removed_count uint16_t ids, and block_count edits of three int32_t and a block_t.
+typedef struct {
+	uint32_t tick;
+	uint32_t baseline; //the tick this is a delta against, 0 for everything from scratch
+	uint32_t tick_ns; //how long the server took for its previous tick
+	uint16_t entity_count;
+	uint16_t removed_count;
+	uint32_t block_count;
+} net_snapshot_header_t;
+_Static_assert(sizeof(net_snapshot_header_t) == 20,"the header is sent as is");
+
+enum {
+	NET_CHANGED_X = 1,
+	NET_CHANGED_Y = 2,
+	NET_CHANGED_Z = 4,
+	NET_CHANGED_ROTATION = 8,
+	NET_CHANGED_LOOK = 16, //kind, color and range, always set for new entities
+};
+
+typedef struct {
+	uint8_t *data;
+	int count, capacity;
+} net_buffer_t;
+
+void net_buffer_append(net_buffer_t *b, void *data, int size);
+void net_buffer_consume(net_buffer_t *b, int size); //drops size bytes from the front
+
+//the state a client would see of the sim. players go in by their client's id with p 0 for ids
+//not connected.
+void net_state_set_player(net_state_t *s, int id, entity_t *p);
+void net_state_set_lights(net_state_t *s);
+
+//appends a whole NET_SNAPSHOT message. baseline 0 sends every entity. blocks are the edits the
+//client hasn't had yet.
+void net_encode_snapshot(net_buffer_t *out, net_state_t *state, net_state_t *baseline, uint32_t tick_ns, net_block_t *blocks, int block_count);
+//applies a NET_SNAPSHOT payload onto state, which must hold its baseline, and appends its block
+//edits to blocks. false if it's malformed or for another baseline, state is garbage then.
+bool net_apply_snapshot(net_state_t *state, uint8_t *payload, int size, net_buffer_t *blocks, uint32_t *tick_ns);
+
+//unix domain stream sockets, not available on windows. all of them are non-blocking.
+int net_listen(char *path); //-1 on failure, replaces a stale socket file
+int net_accept(int listener); //-1 when there's no one waiting
+int net_send(int socket, void *data, int size); //bytes taken, 0 if none fit, -1 once it's closed
+int net_receive(int socket, net_buffer_t *b); //appends what arrived, 0 if nothing did, -1 once it's closed
+void net_close(int socket);
+
+//the client end
+typedef struct {
+	int socket; //-1 when not connected
+	uint32_t client; //our player's entity id
+	net_buffer_t in, out;
+	net_state_t state, previous;
+	uint64_t time; //get_time() when the newest arrived
+	net_buffer_t blocks; //net_block_t edits received and not yet taken
+	net_input_t input; //last sent
+	uint64_t snapshots, bytes_received;
+	uint32_t server_tick_ns; //from the newest snapshot
+} net_client_t;
+
+bool net_client_connect(net_client_t *c, char *path); //blocks until welcomed
+void net_client_close(net_client_t *c);
+//sends keys and head rotation if they changed, just_attacked counts as a click
+bool net_client_send_input(net_client_t *c, keys_t *k, vec2 head_rotation);
+int net_client_poll(net_client_t *c); //snapshots applied without waiting, -1 once disconnected
+void net_client_get_snapshot(net_client_t *c, sim_snapshot_t *s); //the newest, for sim_receive
@@ -0,0 +1,224 @@
+#include "tiny3d.h"
+#include "pool.h"
+#include "profile.h"
+
+#include <stdatomic.h>
+
+void barrier_init(barrier_t *b, int count){
+	thd_mutex_init(&b->mutex);
+	thd_condition_init(&b->condition);
+	b->count = count;
+	b->waiting = 0;
+	b->generation = 0;
+}
+
+void barrier_wait(barrier_t *b){
+	thd_mutex_lock(&b->mutex);
+	unsigned generation = b->generation;
+	if (++b->waiting == b->count){
+		b->waiting = 0;
+		b->generation++;
+		thd_condition_broadcast(&b->condition);
+	} else {
+		while (generation == b->generation){
+			thd_condition_wait(&b->condition,&b->mutex);
+		}
+	}
+	thd_mutex_unlock(&b->mutex);
+}
+
+void barrier_destroy(barrier_t *b){
+	thd_condition_destroy(&b->condition);
+	thd_mutex_destroy(&b->mutex);
+}
+
+//each thread owns a contiguous run of job indices packed as (end << 32) | next.
+//the owner pops from the front, thieves pop from the back, both with a single CAS.
+typedef struct {
+	_Alignas(64) _Atomic uint64_t range;
+	uint64_t busy_ns;
+	uint64_t jobs;
+	pool_t *pool;
+	int thread_index;
+} job_queue_t;
+
+struct pool {
+	int thread_count;
+	char name[24];
+	thd_thread threads[POOL_MAX_THREADS];
+	job_queue_t queues[POOL_MAX_THREADS];
+	barrier_t start, finish;
+	pool_job_fn fn;
+	void *data;
+	uint64_t wall_ns;
+};
+
+//static so the queues really are on their own cache lines. 0 is the shared pool.
+static pool_t pools[POOL_MAX_POOLS];
+static pool_t *const shared = pools;
+static int pool_count = 1;
+
+static bool take_front(job_queue_t *q, int *index){
+	uint64_t r = atomic_load_explicit(&q->range,memory_order_relaxed);
+	for (;;){
+		uint32_t next = (uint32_t)r;
+		uint32_t end = (uint32_t)(r >> 32);
+		if (next >= end){
+			return false;
+		}
+		if (atomic_compare_exchange_weak(&q->range,&r,r+1)){
+			*index = next;
+			return true;
+		}
+	}
+}
+
+static bool take_back(job_queue_t *q, int *index){
+	uint64_t r = atomic_load_explicit(&q->range,memory_order_relaxed);
+	for (;;){
+		uint32_t next = (uint32_t)r;
+		uint32_t end = (uint32_t)(r >> 32);
+		if (next >= end){
+			return false;
+		}
+		if (atomic_compare_exchange_weak(&q->range,&r,((uint64_t)(end-1) << 32) | next)){
+			*index = end-1;
+			return true;
+		}
+	}
+}
+
+static void run_jobs(pool_t *pool, int thread_index){
+	job_queue_t *q = pool->queues+thread_index;
+	uint64_t t0 = get_time();
+	int index;
+	while (take_front(q,&index)){
+		pool->fn(index,thread_index,pool->data);
+		q->jobs++;
+	}
+	for (int i = 1; i < pool->thread_count; i++){
+		job_queue_t *victim = pool->queues + (thread_index+i) % pool->thread_count;
+		while (take_back(victim,&index)){
+			pool->fn(index,thread_index,pool->data);
+			q->jobs++;
+		}
+	}
+	q->busy_ns += get_time() - t0;
+}
+
+static void worker(void *data){
+	job_queue_t *q = data;
+	pool_t *pool = q->pool;
+	char name[48];
+	snprintf(name,sizeof(name),"%s %d",pool->name,q->thread_index);
+	profile_set_thread_name(name);
+	for (;;){
+		barrier_wait(&pool->start);
+		run_jobs(pool,q->thread_index);
+		barrier_wait(&pool->finish);
+	}
+}
+
+static void start_pool(pool_t *pool, int thread_count, char *name){
+	ASSERT(!pool->thread_count);
+	if (thread_count <= 0){
+		thread_count = thd_processor_count();
+	}
+	pool->thread_count = CLAMP(thread_count,1,POOL_MAX_THREADS);
+	snprintf(pool->name,sizeof(pool->name),"%s",name);
+	barrier_init(&pool->start,pool->thread_count);
+	barrier_init(&pool->finish,pool->thread_count);
+	for (int i = 0; i < pool->thread_count; i++){
+		pool->queues[i].pool = pool;
+		pool->queues[i].thread_index = i;
+	}
+	for (int i = 1; i < pool->thread_count; i++){
+		ASSERT(!thd_thread_detach(pool->threads+i,worker,pool->queues+i));
+	}
+}
+
+void pool_init(int thread_count){
+	start_pool(shared,thread_count,"worker");
+}
+
+int pool_get_thread_count(void){
+	return shared->thread_count;
+}
+
+pool_t *pool_create(int thread_count, char *name){
+	ASSERT(pool_count < POOL_MAX_POOLS);
+	pool_t *pool = pools + pool_count++;
+	start_pool(pool,thread_count,name);
+	return pool;
+}
+
+void pool_run(pool_t *pool, int job_count, pool_job_fn fn, void *data){
+	if (!pool){
+		pool = shared;
+		if (!pool->thread_count){
+			pool_init(0);
+		}
+	}
+	pool->fn = fn;
+	pool->data = data;
+	for (int i = 0; i < pool->thread_count; i++){
+		uint64_t next = (uint64_t)job_count * i / pool->thread_count;
+		uint64_t end = (uint64_t)job_count * (i+1) / pool->thread_count;
+		atomic_store_explicit(&pool->queues[i].range,(end << 32) | next,memory_order_relaxed);
+	}
+	uint64_t t0 = get_time();
+	if (pool->thread_count == 1){
+		run_jobs(pool,0);
+	} else {
+		barrier_wait(&pool->start);
+		run_jobs(pool,0);
+		barrier_wait(&pool->finish);
+	}
+	pool->wall_ns += get_time() - t0;
+}
+
+void pool_for(int job_count, pool_job_fn fn, void *data){
+	pool_run(0,job_count,fn,data);
+}
+
+void pool_get_stats(pool_stats_t *stats){
+	memset(stats,0,sizeof(*stats));
+	stats->wall_ns = shared->wall_ns;
+	for (int i = 0; i < shared->thread_count; i++){
+		stats->busy_ns[i] = shared->queues[i].busy_ns;
+		stats->jobs[i] = shared->queues[i].jobs;
+	}
+}
+
+void pool_reset_stats(void){
+	shared->wall_ns = 0;
+	for (int i = 0; i < shared->thread_count; i++){
+		shared->queues[i].busy_ns = 0;
+		shared->queues[i].jobs = 0;
+	}
+}
+
+typedef struct {
+	int width, height, tile_size, tiles_x;
+	pool_tile_fn fn;
+	void *data;
+} tile_job_t;
+
+static void tile_job(int job_index, int thread_index, void *data){
+	tile_job_t *t = data;
+	int x0 = (job_index % t->tiles_x) * t->tile_size;
+	int y0 = (job_index / t->tiles_x) * t->tile_size;
+	t->fn(x0,y0,MIN(x0+t->tile_size,t->width),MIN(y0+t->tile_size,t->height),thread_index,t->data);
+}
+
+void pool_for_tiles(int width, int height, int tile_size, pool_tile_fn fn, void *data){
+	tile_job_t t = {
+		.width = width,
+		.height = height,
+		.tile_size = tile_size,
+		.tiles_x = (width+tile_size-1)/tile_size,
+		.fn = fn,
+		.data = data,
+	};
+	pool_for(t.tiles_x * ((height+tile_size-1)/tile_size),tile_job,&t);
+}
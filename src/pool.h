@@ -0,0 +1,48 @@
+#pragma once
+
+#include "thd.h"
+
+//frame barrier: every participant blocks in barrier_wait until count of them have arrived.
+typedef struct {
+	thd_mutex mutex;
+	thd_condition condition;
+	int count;
+	int waiting;
+	unsigned generation;
+} barrier_t;
+
+void barrier_init(barrier_t *b, int count);
+void barrier_wait(barrier_t *b);
+void barrier_destroy(barrier_t *b);
+
+//persistent worker pool. the calling thread takes part as thread 0, so
+//pool_for returns once every job has run. jobs must not call back into the pool.
+#define POOL_MAX_THREADS 64
+
+typedef void (*pool_job_fn)(int job_index, int thread_index, void *data);
+typedef void (*pool_tile_fn)(int x0, int y0, int x1, int y1, int thread_index, void *data);
+
+void pool_init(int thread_count); //thread_count = 0: one thread per processor
+int pool_get_thread_count(void);
+void pool_for(int job_count, pool_job_fn fn, void *data);
+void pool_for_tiles(int width, int height, int tile_size, pool_tile_fn fn, void *data);
+
+//the functions above drive one shared pool, which only one thread may submit to. a thread
+//that runs alongside that one, like the sim, creates a pool of its own and submits with
+//pool_run. pools live as long as the process; a 0 pool is the shared one.
+#define POOL_MAX_POOLS 4
+typedef struct pool pool_t;
+
+pool_t *pool_create(int thread_count, char *name); //name prefixes its workers' thread names
+void pool_run(pool_t *pool, int job_count, pool_job_fn fn, void *data);
+
+//time the shared pool accumulated since the last pool_reset_stats. busy_ns counts only time spent
+//running jobs; wall_ns is the total time spent inside pool_for.
+typedef struct {
+	uint64_t wall_ns;
+	uint64_t busy_ns[POOL_MAX_THREADS];
+	uint64_t jobs[POOL_MAX_THREADS];
+} pool_stats_t;
+
+void pool_get_stats(pool_stats_t *stats);
+void pool_reset_stats(void);
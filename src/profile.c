@@ -0,0 +1,166 @@
+#include "profile.h"
+
+#include <stdatomic.h>
+
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+_Atomic bool profile_enabled;
+
+typedef struct {
+	char *name;
+	uint64_t start, end;
+} profile_event_t;
+
+//single writer: only the owning thread appends. readers copy without locking and drop
+//whatever the writer may have overwritten in the meantime.
+typedef struct {
+	_Atomic uint64_t head; //events ever written
+	char name[32];
+	profile_event_t events[PROFILE_RING];
+} profile_ring_t;
+
+static _Atomic(profile_ring_t *) rings[PROFILE_MAX_THREADS];
+static _Atomic int ring_count;
+static THREAD_LOCAL profile_ring_t *self;
+static THREAD_LOCAL char thread_name[32];
+
+//rings are only allocated once a thread records something
+static profile_ring_t *get_ring(void){
+	if (!self){
+		int i = atomic_fetch_add(&ring_count,1);
+		ASSERT(i < PROFILE_MAX_THREADS);
+		profile_ring_t *r = calloc(1,sizeof(*r));
+		ASSERT(r);
+		if (thread_name[0]){
+			memcpy(r->name,thread_name,sizeof(r->name));
+		} else {
+			snprintf(r->name,sizeof(r->name),"thread %d",i);
+		}
+		atomic_store(rings+i,r);
+		self = r;
+	}
+	return self;
+}
+
+void profile_record(char *name, uint64_t start, uint64_t end){
+	profile_ring_t *r = get_ring();
+	uint64_t h = atomic_load_explicit(&r->head,memory_order_relaxed);
+	profile_event_t *e = r->events + (h & (PROFILE_RING-1));
+	e->name = name;
+	e->start = start;
+	e->end = end;
+	atomic_store_explicit(&r->head,h+1,memory_order_release);
+}
+
+void profile_set_thread_name(char *name){
+	snprintf(thread_name,sizeof(thread_name),"%s",name);
+	if (self){
+		memcpy(self->name,thread_name,sizeof(self->name));
+	}
+}
+
+//copies a ring's events, oldest first. the writer may be filling slot head+k while we copy,
+//which clobbers event head+k-PROFILE_RING, so everything it could have reached is dropped.
+static int snapshot(profile_ring_t *r, profile_event_t *out){
+	uint64_t head = atomic_load_explicit(&r->head,memory_order_acquire);
+	uint64_t first = head > PROFILE_RING ? head - PROFILE_RING : 0;
+	for (uint64_t i = first; i < head; i++){
+		out[i-first] = r->events[i & (PROFILE_RING-1)];
+	}
+	uint64_t after = atomic_load_explicit(&r->head,memory_order_acquire);
+	uint64_t safe = after+1 > PROFILE_RING ? after+1 - PROFILE_RING : 0;
+	if (safe <= first){
+		return (int)(head - first);
+	}
+	if (safe >= head){
+		return 0;
+	}
+	memmove(out,out + (safe-first),(head-safe)*sizeof(*out));
+	return (int)(head - safe);
+}
+
+bool profile_write_trace(char *path){
+	FILE *f = fopen(path,"w");
+	if (!f){
+		return false;
+	}
+	profile_event_t *events = malloc(PROFILE_RING*sizeof(*events));
+	ASSERT(events);
+	fprintf(f,"{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	bool first = true;
+	int count = MIN(atomic_load(&ring_count),PROFILE_MAX_THREADS);
+	for (int t = 0; t < count; t++){
+		profile_ring_t *r = atomic_load(rings+t);
+		if (!r){
+			continue;
+		}
+		fprintf(f,"%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",first ? "" : ",\n",t,r->name);
+		first = false;
+		int n = snapshot(r,events);
+		for (int i = 0; i < n; i++){
+			profile_event_t *e = events+i;
+			fprintf(f,",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+				e->name,t,e->start / 1e3,(e->end - e->start) / 1e3);
+		}
+	}
+	fprintf(f,"\n]}\n");
+	free(events);
+	return !fclose(f);
+}
+
+int profile_summary(profile_zone_t *zones, int max_zones, char *frame_zone, uint64_t window_ns){
+	profile_event_t *events = malloc(PROFILE_RING*sizeof(*events));
+	ASSERT(events);
+	uint64_t now = get_time();
+	uint64_t from = now > window_ns ? now - window_ns : 0;
+	uint64_t total[PROFILE_MAX_ZONES] = {0}, busiest[PROFILE_MAX_ZONES] = {0};
+	int zone_count = 0, frames = 0;
+	max_zones = MIN(max_zones,PROFILE_MAX_ZONES);
+	int count = MIN(atomic_load(&ring_count),PROFILE_MAX_THREADS);
+	for (int t = 0; t < count; t++){
+		profile_ring_t *r = atomic_load(rings+t);
+		if (!r){
+			continue;
+		}
+		uint64_t mine[PROFILE_MAX_ZONES] = {0};
+		int n = snapshot(r,events);
+		for (int i = 0; i < n; i++){
+			profile_event_t *e = events+i;
+			if (e->end < from){
+				continue;
+			}
+			if (!strcmp(e->name,frame_zone)){
+				frames++;
+			}
+			int z = 0;
+			while (z < zone_count && strcmp(zones[z].name,e->name)){
+				z++;
+			}
+			if (z == zone_count){
+				if (zone_count == max_zones){
+					continue;
+				}
+				zones[zone_count++] = (profile_zone_t){.name = e->name};
+			}
+			mine[z] += e->end - e->start;
+		}
+		for (int z = 0; z < zone_count; z++){
+			if (mine[z]){
+				total[z] += mine[z];
+				busiest[z] = MAX(busiest[z],mine[z]);
+				zones[z].threads++;
+			}
+		}
+	}
+	free(events);
+	frames = MAX(frames,1);
+	for (int z = 0; z < zone_count; z++){
+		zones[z].ms_per_frame = (float)(total[z] / 1e6 / frames);
+		zones[z].max_thread_ms_per_frame = (float)(busiest[z] / 1e6 / frames);
+	}
+	return zone_count;
+}
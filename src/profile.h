@@ -0,0 +1,45 @@
+#pragma once
+
+#include "tiny3d.h"
+
+#include <stdatomic.h>
+
+//frame profiler. a zone is timed with
+//	uint64_t t = profile_begin();
+//	...
+//	profile_end("name",t);
+//and lands in the calling thread's ring buffer. while the profiler is off profile_begin
+//returns 0 and profile_end does nothing, so a zone costs a load and a branch.
+//names must be string literals or otherwise outlive the profiler.
+#define PROFILE_RING 16384 //events kept per thread, a power of two
+#define PROFILE_MAX_THREADS 96
+#define PROFILE_MAX_ZONES 32 //distinct names in a summary
+
+extern _Atomic bool profile_enabled; //main thread writes it, every thread reads it when it likes
+
+void profile_record(char *name, uint64_t start, uint64_t end);
+
+static inline uint64_t profile_begin(void){
+	return atomic_load_explicit(&profile_enabled,memory_order_relaxed) ? get_time() : 0;
+}
+
+static inline void profile_end(char *name, uint64_t start){
+	if (start){
+		profile_record(name,start,get_time());
+	}
+}
+
+void profile_set_thread_name(char *name);
+
+//everything still in the rings as chrome trace_event json (chrome://tracing, perfetto).
+bool profile_write_trace(char *path);
+
+//per zone time over the last window_ns, divided by the number of frame_zone events in it.
+typedef struct {
+	char *name;
+	float ms_per_frame; //summed over threads
+	float max_thread_ms_per_frame; //the busiest thread's share
+	int threads;
+} profile_zone_t;
+
+int profile_summary(profile_zone_t *zones, int max_zones, char *frame_zone, uint64_t window_ns);
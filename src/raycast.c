@@ -0,0 +1,162 @@
+#include "raycast.h"
+
+char *raycast_engine_names[RAYCAST_ENGINE_COUNT] = {
+	"dda",
+	"bricks",
+	"sdf",
+};
+
+raycast_engine_t raycast_engine = RAYCAST_BRICKS;
+
+//t at which the ray leaves cell p along one axis. it is computed from the cell boundary
+//instead of being accumulated step by step, so skipping cells lands on the same values.
+static inline float crossing(int p, int step, float origin, float inv){
+	return ((float)(p + (step > 0)) - origin) * inv;
+}
+
+//moves p along one axis past every crossing with t < limit and t <= 1.
+//crossings grow monotonically along an axis, so we start from the cell the ray
+//is estimated to be in at min(limit,1) and correct the estimate in either direction.
+static int jump_axis(int p, int step, float origin, float ray, float inv, float limit){
+	if (ray == 0){
+		return p;
+	}
+	int c = (int)floorf(origin + MIN(limit,1.0f) * ray);
+	if ((c - p) * step < 0){
+		c = p;
+	}
+	while (c != p){
+		float e = crossing(c-step,step,origin,inv);
+		if (e < limit && e <= 1.0f){
+			break;
+		}
+		c -= step;
+	}
+	for (;;){
+		float e = crossing(c,step,origin,inv);
+		if (!(e < limit && e <= 1.0f)){
+			break;
+		}
+		c += step;
+	}
+	return c;
+}
+
+void raycast_skip_empty_bricks(vec3 origin, vec3 ray, ivec3 step, vec3 inv, ivec3 p, vec3 next){
+	//brick level dda from the current brick. brick boundaries are a subset of the cell
+	//boundaries, so this visits bricks in the same order the cell dda would.
+	int b[3];
+	float bnext[3];
+	for (int i = 0; i < 3; i++){
+		b[i] = p[i] >> BRICK_SHIFT;
+		int last = (b[i] << BRICK_SHIFT) + (step[i] > 0 ? BRICK_WIDTH-1 : 0);
+		bnext[i] = crossing(last,step[i],origin[i],inv[i]);
+	}
+	float limit = HUGE_VALF;
+	for (;;){
+		float d = HUGE_VALF;
+		int index = 0;
+		for (int i = 0; i < 3; i++){
+			if (bnext[i] < d){
+				index = i;
+				d = bnext[i];
+			}
+		}
+		if (!(d <= 1.0f)){
+			break;
+		}
+		b[index] += step[index];
+		if (!brick_is_empty(b[0],b[1],b[2])){
+			limit = d;
+			break;
+		}
+		bnext[index] = crossing((b[index] << BRICK_SHIFT) + (step[index] > 0 ? BRICK_WIDTH-1 : 0),step[index],origin[index],inv[index]);
+	}
+	//take every cell crossing before the one that enters the non-empty brick
+	for (int i = 0; i < 3; i++){
+		p[i] = jump_axis(p[i],step[i],origin[i],ray[i],inv[i],limit);
+		next[i] = crossing(p[i],step[i],origin[i],inv[i]);
+	}
+}
+
+void raycast_skip_distance(vec3 origin, vec3 ray, ivec3 step, vec3 inv, ivec3 p, vec3 next, int distance){
+	//the ray is in the air cube until it crosses the cube's far face on some axis
+	float limit = HUGE_VALF;
+	for (int i = 0; i < 3; i++){
+		int lo = p[i] & ~(CHUNK_WIDTH-1);
+		int last = step[i] > 0 ? MIN(p[i]+distance-1,lo+CHUNK_WIDTH-1) : MAX(p[i]-distance+1,lo);
+		limit = MIN(limit,crossing(last,step[i],origin[i],inv[i]));
+	}
+	for (int i = 0; i < 3; i++){
+		p[i] = jump_axis(p[i],step[i],origin[i],ray[i],inv[i],limit);
+		next[i] = crossing(p[i],step[i],origin[i],inv[i]);
+	}
+}
+
+void cast_ray_into_blocks(vec3 origin, vec3 ray, block_raycast_result_t *result){
+	cast_ray_into_blocks_from(origin,ray,0.0f,result);
+}
+
+void cast_ray_into_blocks_from(vec3 origin, vec3 ray, float start, block_raycast_result_t *result){
+	bool skip = raycast_engine == RAYCAST_BRICKS;
+	bool sdf = raycast_engine == RAYCAST_SDF;
+	int *p = result->block_pos;
+	int step[3];
+	float inv[3], next[3];
+	for (int i = 0; i < 3; i++){
+		p[i] = (int)floorf(origin[i]);
+		step[i] = ray[i] < 0 ? -1 : 1;
+		inv[i] = ray[i] == 0 ? HUGE_VALF : 1.0f / ray[i];
+		next[i] = crossing(p[i],step[i],origin[i],inv[i]);
+	}
+	//the cell we land in is air, so going on from there visits the same cells past it
+	if (start > 0){
+		for (int i = 0; i < 3; i++){
+			p[i] = jump_axis(p[i],step[i],origin[i],ray[i],inv[i],start);
+			next[i] = crossing(p[i],step[i],origin[i],inv[i]);
+		}
+	}
+	float t = 0;
+	int index = 0;
+	//last chunk cache, only goes back to the chunk index when the ray crosses into another chunk
+	chunk_t *chunk = 0;
+	int cc[3] = {INT_MIN,INT_MIN,INT_MIN};
+	while (t <= 1.0f){
+		if (p[0] >> CHUNK_SHIFT != cc[0] || p[1] >> CHUNK_SHIFT != cc[1] || p[2] >> CHUNK_SHIFT != cc[2]){
+			for (int i = 0; i < 3; i++){
+				cc[i] = p[i] >> CHUNK_SHIFT;
+			}
+			chunk = get_chunk(cc[0],cc[1],cc[2]);
+		}
+		uint64_t cells = skip && chunk ? chunk->brick_cells[chunk_brick_index(p[0] >> BRICK_SHIFT,p[1] >> BRICK_SHIFT,p[2] >> BRICK_SHIFT)] : 0;
+		int distance = sdf ? (chunk ? chunk->distance[chunk_block_index(p[0],p[1],p[2])] : CHUNK_WIDTH) : 0;
+		if (skip && !cells){
+			raycast_skip_empty_bricks(origin,ray,step,inv,p,next);
+		} else if (distance > 1){
+			raycast_skip_distance(origin,ray,step,inv,p,next,distance);
+		} else {
+			result->block = chunk && (!skip || (cells & cell_bit(p[0],p[1],p[2]))) ? chunk->blocks + chunk_block_index(p[0],p[1],p[2]) : 0;
+			if (result->block && result->block[0]){
+				for (int i = 0; i < 3; i++){
+					result->face_normal[i] = 0;
+				}
+				result->face_normal[index] = -step[index];
+				result->t = t;
+				return;
+			}
+		}
+		float d = HUGE_VALF;
+		index = 0;
+		for (int i = 0; i < 3; i++){
+			if (next[i] < d){
+				index = i;
+				d = next[i];
+			}
+		}
+		p[index] += step[index];
+		t = next[index];
+		next[index] = crossing(p[index],step[index],origin[index],inv[index]);
+	}
+	result->block = 0;
+	result->t = t;
+}
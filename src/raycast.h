@@ -0,0 +1,53 @@
+#pragma once
+
+#include "world.h"
+
+typedef struct {
+	block_t *block;
+	ivec3 block_pos;
+	ivec3 face_normal;
+	float t;
+} block_raycast_result_t;
+
+//traversal engines. every engine returns exactly what the plain dda returns,
+//they only differ in how many cells they visit to get there.
+typedef enum {
+	RAYCAST_DDA,
+	RAYCAST_BRICKS,
+	RAYCAST_SDF, //jumps by the chunk distance fields
+	RAYCAST_ENGINE_COUNT
+} raycast_engine_t;
+
+extern char *raycast_engine_names[RAYCAST_ENGINE_COUNT];
+extern raycast_engine_t raycast_engine;
+
+void cast_ray_into_blocks(vec3 origin, vec3 ray, block_raycast_result_t *result);
+//for a caller that knows every cell the ray touches up to start is air. the traversal jumps
+//straight there and returns exactly what it would have from 0.
+void cast_ray_into_blocks_from(vec3 origin, vec3 ray, float start, block_raycast_result_t *result);
+
+//advances a traversal whose cell p lies in an empty brick to the last cell before the
+//next non-empty brick (or the end of the ray). shared by the scalar and packet paths.
+void raycast_skip_empty_bricks(vec3 origin, vec3 ray, ivec3 step, vec3 inv, ivec3 p, vec3 next);
+
+//advances a traversal past the air around p: every cell of p's chunk within distance-1 of p.
+void raycast_skip_distance(vec3 origin, vec3 ray, ivec3 step, vec3 inv, ivec3 p, vec3 next, int distance);
+
+//packet traversal of up to RAY_PACKET_MAX rays. results match cast_ray_into_blocks lane for lane.
+//the instruction set is picked at runtime from what the cpu supports.
+#define RAY_PACKET_MAX 8
+
+typedef enum {
+	RAY_PACKET_SCALAR,
+	RAY_PACKET_SSE41,
+	RAY_PACKET_AVX2,
+	RAY_PACKET_MODE_COUNT
+} ray_packet_mode_t;
+
+extern char *ray_packet_mode_names[RAY_PACKET_MODE_COUNT];
+
+ray_packet_mode_t raycast_best_packet_mode(void);
+void raycast_set_packet_mode(ray_packet_mode_t mode); //clamped to the best supported mode
+ray_packet_mode_t raycast_get_packet_mode(void);
+void cast_ray_packet_into_blocks(int count, vec3 *origins, vec3 *rays, block_raycast_result_t *results);
+void cast_ray_packet_into_blocks_from(int count, vec3 *origins, vec3 *rays, float start, block_raycast_result_t *results);
@@ -0,0 +1,248 @@
+#include "raycast.h"
+
+//packet traversal: cast_ray_into_blocks run on 4 (sse4.1) or 8 (avx2) rays at once.
+//the kernel itself lives in raycast_packet_kernel.h.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RAYCAST_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET(t)
+#else
+#define TARGET(t) __attribute__((target(t)))
+#endif
+#endif
+
+char *ray_packet_mode_names[RAY_PACKET_MODE_COUNT] = {
+	"scalar",
+	"sse4.1",
+	"avx2",
+};
+
+static void write_hit(block_raycast_result_t *r, block_t *block, int x, int y, int z, int index, float ray_component, float t){
+	r->block = block;
+	r->block_pos[0] = x;
+	r->block_pos[1] = y;
+	r->block_pos[2] = z;
+	for (int i = 0; i < 3; i++){
+		r->face_normal[i] = 0;
+	}
+	r->face_normal[index] = ray_component < 0 ? 1 : -1;
+	r->t = t;
+}
+
+static void write_miss(block_raycast_result_t *r, int x, int y, int z, float t){
+	r->block = 0;
+	r->block_pos[0] = x;
+	r->block_pos[1] = y;
+	r->block_pos[2] = z;
+	r->t = t;
+}
+
+#if RAYCAST_X86
+
+#define W 4
+#define KERNEL cast_packet_sse41
+#define LANE_MASK lane_mask_sse41
+#define KERNEL_TARGET TARGET("sse4.1")
+#define VF __m128
+#define VI __m128i
+#define VF_SET1 _mm_set1_ps
+#define VF_LOAD _mm_load_ps
+#define VF_STORE _mm_store_ps
+#define VF_ADD _mm_add_ps
+#define VF_SUB _mm_sub_ps
+#define VF_MUL _mm_mul_ps
+#define VF_DIV _mm_div_ps
+#define VF_FLOOR _mm_floor_ps
+#define VF_AND _mm_and_ps
+#define VF_OR _mm_or_ps
+#define VF_ANDNOT _mm_andnot_ps
+#define VF_LT _mm_cmplt_ps
+#define VF_LE _mm_cmple_ps
+#define VF_EQ _mm_cmpeq_ps
+#define VF_BLEND _mm_blendv_ps
+#define VF_MOVEMASK _mm_movemask_ps
+#define VF_FROM_I _mm_cvtepi32_ps
+#define VF_FROM_MASK _mm_castsi128_ps
+#define VI_SET1 _mm_set1_epi32
+#define VI_LOAD(p) _mm_load_si128((__m128i *)(p))
+#define VI_STORE(p,v) _mm_store_si128((__m128i *)(p),v)
+#define VI_ADD _mm_add_epi32
+#define VI_SUB _mm_sub_epi32
+#define VI_MIN _mm_min_epi32
+#define VI_MAX _mm_max_epi32
+#define VI_AND _mm_and_si128
+#define VI_OR _mm_or_si128
+#define VI_ANDNOT _mm_andnot_si128
+#define VI_EQ _mm_cmpeq_epi32
+#define VI_SLL _mm_slli_epi32
+#define VI_SRA _mm_srai_epi32
+#define VI_BLEND _mm_blendv_epi8
+#define VI_FROM_F _mm_cvttps_epi32
+#define VI_FROM_MASK _mm_castps_si128
+#include "raycast_packet_kernel.h"
+#undef W
+#undef KERNEL
+#undef LANE_MASK
+#undef KERNEL_TARGET
+#undef VF
+#undef VI
+#undef VF_SET1
+#undef VF_LOAD
+#undef VF_STORE
+#undef VF_ADD
+#undef VF_SUB
+#undef VF_MUL
+#undef VF_DIV
+#undef VF_FLOOR
+#undef VF_AND
+#undef VF_OR
+#undef VF_ANDNOT
+#undef VF_LT
+#undef VF_LE
+#undef VF_EQ
+#undef VF_BLEND
+#undef VF_MOVEMASK
+#undef VF_FROM_I
+#undef VF_FROM_MASK
+#undef VI_SET1
+#undef VI_LOAD
+#undef VI_STORE
+#undef VI_ADD
+#undef VI_SUB
+#undef VI_MIN
+#undef VI_MAX
+#undef VI_AND
+#undef VI_OR
+#undef VI_ANDNOT
+#undef VI_EQ
+#undef VI_SLL
+#undef VI_SRA
+#undef VI_BLEND
+#undef VI_FROM_F
+#undef VI_FROM_MASK
+
+#define W 8
+#define KERNEL cast_packet_avx2
+#define LANE_MASK lane_mask_avx2
+#define KERNEL_TARGET TARGET("avx2")
+#define VF __m256
+#define VI __m256i
+#define VF_SET1 _mm256_set1_ps
+#define VF_LOAD _mm256_load_ps
+#define VF_STORE _mm256_store_ps
+#define VF_ADD _mm256_add_ps
+#define VF_SUB _mm256_sub_ps
+#define VF_MUL _mm256_mul_ps
+#define VF_DIV _mm256_div_ps
+#define VF_FLOOR _mm256_floor_ps
+#define VF_AND _mm256_and_ps
+#define VF_OR _mm256_or_ps
+#define VF_ANDNOT _mm256_andnot_ps
+#define VF_LT(a,b) _mm256_cmp_ps(a,b,_CMP_LT_OQ)
+#define VF_LE(a,b) _mm256_cmp_ps(a,b,_CMP_LE_OQ)
+#define VF_EQ(a,b) _mm256_cmp_ps(a,b,_CMP_EQ_OQ)
+#define VF_BLEND _mm256_blendv_ps
+#define VF_MOVEMASK _mm256_movemask_ps
+#define VF_FROM_I _mm256_cvtepi32_ps
+#define VF_FROM_MASK _mm256_castsi256_ps
+#define VI_SET1 _mm256_set1_epi32
+#define VI_LOAD(p) _mm256_load_si256((__m256i *)(p))
+#define VI_STORE(p,v) _mm256_store_si256((__m256i *)(p),v)
+#define VI_ADD _mm256_add_epi32
+#define VI_SUB _mm256_sub_epi32
+#define VI_MIN _mm256_min_epi32
+#define VI_MAX _mm256_max_epi32
+#define VI_AND _mm256_and_si256
+#define VI_OR _mm256_or_si256
+#define VI_ANDNOT _mm256_andnot_si256
+#define VI_EQ _mm256_cmpeq_epi32
+#define VI_SLL _mm256_slli_epi32
+#define VI_SRA _mm256_srai_epi32
+#define VI_BLEND _mm256_blendv_epi8
+#define VI_FROM_F _mm256_cvttps_epi32
+#define VI_FROM_MASK _mm256_castps_si256
+#include "raycast_packet_kernel.h"
+
+static bool cpu_supports(ray_packet_mode_t mode){
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info,1);
+	bool sse41 = info[2] & (1 << 19);
+	bool osxsave = info[2] & (1 << 27);
+	bool avx = info[2] & (1 << 28);
+	bool avx2 = false;
+	if (osxsave && avx && (_xgetbv(0) & 6) == 6){
+		__cpuidex(info,7,0);
+		avx2 = info[1] & (1 << 5);
+	}
+	return mode == RAY_PACKET_AVX2 ? avx2 : mode == RAY_PACKET_SSE41 ? sse41 : true;
+#else
+	__builtin_cpu_init();
+	switch (mode){
+		case RAY_PACKET_AVX2: return __builtin_cpu_supports("avx2");
+		case RAY_PACKET_SSE41: return __builtin_cpu_supports("sse4.1");
+		default: return true;
+	}
+#endif
+}
+
+#else
+
+static bool cpu_supports(ray_packet_mode_t mode){
+	return mode == RAY_PACKET_SCALAR;
+}
+
+#endif
+
+ray_packet_mode_t raycast_best_packet_mode(void){
+	static int best = -1;
+	if (best < 0){
+		int mode = RAY_PACKET_MODE_COUNT-1;
+		while (mode > RAY_PACKET_SCALAR && !cpu_supports(mode)){
+			mode--;
+		}
+		best = mode;
+	}
+	return best;
+}
+
+static int packet_mode = -1;
+
+void raycast_set_packet_mode(ray_packet_mode_t mode){
+	packet_mode = MIN(mode,raycast_best_packet_mode());
+}
+
+ray_packet_mode_t raycast_get_packet_mode(void){
+	if (packet_mode < 0){
+		packet_mode = raycast_best_packet_mode(); //racing writers all store the same value
+	}
+	return packet_mode;
+}
+
+void cast_ray_packet_into_blocks(int count, vec3 *origins, vec3 *rays, block_raycast_result_t *results){
+	cast_ray_packet_into_blocks_from(count,origins,rays,0.0f,results);
+}
+
+void cast_ray_packet_into_blocks_from(int count, vec3 *origins, vec3 *rays, float start, block_raycast_result_t *results){
+	ASSERT(count >= 0 && count <= RAY_PACKET_MAX);
+	switch (raycast_get_packet_mode()){
+#if RAYCAST_X86
+		case RAY_PACKET_AVX2:
+			cast_packet_avx2(count,origins,rays,start,results,raycast_engine);
+			return;
+		case RAY_PACKET_SSE41:
+			for (int i = 0; i < count; i += 4){
+				cast_packet_sse41(MIN(4,count-i),origins+i,rays+i,start,results+i,raycast_engine);
+			}
+			return;
+#endif
+		default:
+			for (int i = 0; i < count; i++){
+				cast_ray_into_blocks_from(origins[i],rays[i],start,results+i);
+			}
+			return;
+	}
+}
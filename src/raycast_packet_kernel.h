@@ -0,0 +1,254 @@
+//packet traversal kernel, included once per instruction set by raycast_packet.c with
+//KERNEL, KERNEL_TARGET, W and the V* operation macros defined.
+//it is cast_ray_into_blocks run on W lanes: each lane performs the same float operations
+//in the same order, so per-lane results are bit-identical to the scalar path.
+
+#define CROSSING(p,up,o,inv) VF_MUL(VF_SUB(VF_FROM_I(VI_ADD(p,up)),o),inv)
+#define BRICK_LAST(b,up) VI_ADD(VI_SLL(b,BRICK_SHIFT),VI_AND(VI_SUB(VI_SET1(0),up),VI_SET1(BRICK_WIDTH-1)))
+
+KERNEL_TARGET
+static inline VF LANE_MASK(int bits){
+	_Alignas(32) int m[W];
+	for (int l = 0; l < W; l++){
+		m[l] = bits & (1 << l) ? -1 : 0;
+	}
+	return VF_FROM_MASK(VI_LOAD(m));
+}
+
+KERNEL_TARGET
+static void KERNEL(int count, vec3 *origins, vec3 *rays, float start, block_raycast_result_t *results, raycast_engine_t engine){
+	bool skip = engine == RAYCAST_BRICKS;
+	bool sdf = engine == RAYCAST_SDF;
+	_Alignas(32) float o[3][W], r[3][W];
+	for (int l = 0; l < W; l++){
+		int src = l < count ? l : 0;
+		for (int i = 0; i < 3; i++){
+			o[i][l] = origins[src][i];
+			r[i][l] = rays[src][i];
+		}
+	}
+	VF zero = VF_SET1(0.0f);
+	VF one = VF_SET1(1.0f);
+	VF huge = VF_SET1(HUGE_VALF);
+	VI ione = VI_SET1(1);
+	VI p[3], step[3], up[3];
+	VF org[3], inv[3], next[3];
+	for (int i = 0; i < 3; i++){
+		org[i] = VF_LOAD(o[i]);
+		VF ri = VF_LOAD(r[i]);
+		p[i] = VI_FROM_F(VF_FLOOR(org[i]));
+		VF neg = VF_LT(ri,zero);
+		step[i] = VI_OR(VI_FROM_MASK(neg),ione);
+		up[i] = VI_ANDNOT(VI_FROM_MASK(neg),ione);
+		inv[i] = VF_BLEND(VF_DIV(one,ri),huge,VF_EQ(ri,zero));
+		next[i] = CROSSING(p[i],up[i],org[i],inv[i]);
+	}
+	VF t = zero;
+	VI index = VI_SET1(0);
+	int active = (1 << count) - 1;
+	chunk_t *lane_chunk[W] = {0};
+	VI lane_cc[3];
+	for (int i = 0; i < 3; i++){
+		lane_cc[i] = VI_SET1(INT_MIN); //no chunk coordinate, forces the first lookup
+	}
+	while (active){
+		_Alignas(32) int px[W], py[W], pz[W], axis[W];
+		_Alignas(32) float tl[W];
+		VI_STORE(px,p[0]);
+		VI_STORE(py,p[1]);
+		VI_STORE(pz,p[2]);
+		VF_STORE(tl,t);
+
+		int in_range = VF_MOVEMASK(VF_LE(t,one)) & active;
+		for (int l = 0; l < W; l++){
+			if ((active & ~in_range) & (1 << l)){
+				write_miss(results+l,px[l],py[l],pz[l],tl[l]);
+			}
+		}
+		active = in_range;
+		if (!active){
+			break;
+		}
+
+		//each lane keeps the chunk it was last in and only goes back to the index when it crosses into another
+		VI cc[3];
+		for (int i = 0; i < 3; i++){
+			cc[i] = VI_SRA(p[i],CHUNK_SHIFT);
+		}
+		int moved = ~VF_MOVEMASK(VF_FROM_MASK(VI_AND(VI_AND(VI_EQ(cc[0],lane_cc[0]),VI_EQ(cc[1],lane_cc[1])),VI_EQ(cc[2],lane_cc[2])))) & active;
+		if (moved){
+			_Alignas(32) int cx[W], cy[W], cz[W];
+			VI_STORE(cx,cc[0]);
+			VI_STORE(cy,cc[1]);
+			VI_STORE(cz,cc[2]);
+			for (int l = 0; l < W; l++){
+				if (moved & (1 << l)){
+					lane_chunk[l] = get_chunk(cx[l],cy[l],cz[l]);
+				}
+			}
+			for (int i = 0; i < 3; i++){
+				lane_cc[i] = cc[i];
+			}
+		}
+		VI local = VI_SET1(CHUNK_WIDTH-1);
+		VI lx = VI_AND(p[0],local), ly = VI_AND(p[1],local), lz = VI_AND(p[2],local);
+		_Alignas(32) int cell[W], brick[W], bit[W];
+		VI_STORE(cell,VI_OR(VI_SLL(VI_OR(VI_SLL(ly,CHUNK_SHIFT),lz),CHUNK_SHIFT),lx));
+		VI_STORE(brick,VI_OR(VI_SLL(VI_OR(VI_SLL(VI_SRA(ly,BRICK_SHIFT),CHUNK_SHIFT-BRICK_SHIFT),VI_SRA(lz,BRICK_SHIFT)),CHUNK_SHIFT-BRICK_SHIFT),VI_SRA(lx,BRICK_SHIFT)));
+		VI cellmask = VI_SET1(BRICK_WIDTH-1);
+		VI_STORE(bit,VI_OR(VI_SLL(VI_OR(VI_SLL(VI_AND(ly,cellmask),BRICK_SHIFT),VI_AND(lz,cellmask)),BRICK_SHIFT),VI_AND(lx,cellmask)));
+
+		VI_STORE(axis,index);
+		int empty = 0, far = 0;
+		_Alignas(32) int distance[W];
+		for (int l = 0; l < W; l++){
+			if (!(active & (1 << l))){
+				continue;
+			}
+			chunk_t *c = lane_chunk[l];
+			block_t *b;
+			if (skip){
+				uint64_t cells = c ? c->brick_cells[brick[l]] : 0;
+				if (!cells){
+					empty |= 1 << l;
+					continue;
+				}
+				b = cells >> bit[l] & 1 ? c->blocks + cell[l] : 0;
+			} else if (sdf){
+				distance[l] = c ? c->distance[cell[l]] : CHUNK_WIDTH;
+				if (distance[l] > 1){
+					far |= 1 << l;
+					continue;
+				}
+				b = c ? c->blocks + cell[l] : 0;
+			} else {
+				b = c ? c->blocks + cell[l] : 0;
+			}
+			if (b && *b){
+				write_hit(results+l,b,px[l],py[l],pz[l],axis[l],r[axis[l]][l],tl[l]);
+				active &= ~(1 << l);
+			}
+		}
+		if (!active){
+			break;
+		}
+
+		//lanes that can skip ahead take every crossing before lim, like jump_axis
+		int jumping = 0;
+		VF lim = huge;
+		if (empty){
+			//lanes sitting in an empty brick march whole bricks, then jump to the last cell
+			//before the first non-empty one. same steps as raycast_skip_empty_bricks.
+			VI b[3];
+			VF bnext[3];
+			for (int i = 0; i < 3; i++){
+				b[i] = VI_SRA(p[i],BRICK_SHIFT);
+				bnext[i] = CROSSING(BRICK_LAST(b[i],up[i]),up[i],org[i],inv[i]);
+			}
+			_Alignas(32) float limit[W], dl[W];
+			VF_STORE(limit,huge);
+			int marching = empty;
+			for (;;){
+				VF d = huge;
+				VI bi = VI_SET1(0);
+				for (int i = 0; i < 3; i++){
+					VF m = VF_LT(bnext[i],d);
+					d = VF_BLEND(d,bnext[i],m);
+					bi = VI_BLEND(bi,VI_SET1(i),VI_FROM_MASK(m));
+				}
+				marching &= VF_MOVEMASK(VF_LE(d,one));
+				if (!marching){
+					break;
+				}
+				VF mm = LANE_MASK(marching);
+				VI sel[3];
+				_Alignas(32) int bx[W], by[W], bz[W];
+				for (int i = 0; i < 3; i++){
+					sel[i] = VI_AND(VI_EQ(bi,VI_SET1(i)),VI_FROM_MASK(mm));
+					b[i] = VI_ADD(b[i],VI_AND(sel[i],step[i]));
+				}
+				VI_STORE(bx,b[0]);
+				VI_STORE(by,b[1]);
+				VI_STORE(bz,b[2]);
+				VF_STORE(dl,d);
+				for (int l = 0; l < W; l++){
+					if ((marching & (1 << l)) && !brick_is_empty(bx[l],by[l],bz[l])){
+						limit[l] = dl[l];
+						marching &= ~(1 << l);
+					}
+				}
+				for (int i = 0; i < 3; i++){
+					bnext[i] = VF_BLEND(bnext[i],CROSSING(BRICK_LAST(b[i],up[i]),up[i],org[i],inv[i]),VF_FROM_MASK(sel[i]));
+				}
+			}
+			lim = VF_LOAD(limit);
+			jumping = empty;
+		}
+		if (far){
+			//lanes in open air jump to where they leave their air cube, as in raycast_skip_distance
+			VI reach = VI_SUB(VI_LOAD(distance),ione);
+			for (int i = 0; i < 3; i++){
+				VI lo = VI_SLL(cc[i],CHUNK_SHIFT);
+				VI last = VI_BLEND(VI_MIN(VI_ADD(p[i],reach),VI_ADD(lo,VI_SET1(CHUNK_WIDTH-1))),VI_MAX(VI_SUB(p[i],reach),lo),VI_EQ(step[i],VI_SET1(-1)));
+				VF e = CROSSING(last,up[i],org[i],inv[i]);
+				lim = VF_BLEND(lim,e,VF_LT(e,lim));
+			}
+			jumping = far;
+		}
+		if (start > 0){
+			//the first step jumps to start, or further where the engine already can
+			VF s = VF_SET1(start);
+			lim = VF_BLEND(s,VF_BLEND(lim,s,VF_LT(lim,s)),LANE_MASK(jumping));
+			jumping = active;
+			start = 0;
+		}
+		if (jumping){
+			VF lanes = LANE_MASK(jumping);
+			VF end = VF_BLEND(one,lim,VF_LT(lim,one));
+			for (int i = 0; i < 3; i++){
+				VI c = VI_FROM_F(VF_FLOOR(VF_ADD(org[i],VF_MUL(end,VF_LOAD(r[i])))));
+				c = VI_BLEND(VI_MAX(c,p[i]),VI_MIN(c,p[i]),VI_EQ(step[i],VI_SET1(-1)));
+				for (;;){
+					VI back = VI_SUB(c,step[i]);
+					VF e = CROSSING(back,up[i],org[i],inv[i]);
+					VF taken = VF_AND(VF_LT(e,lim),VF_LE(e,one));
+					VF m = VF_ANDNOT(VF_OR(taken,VF_FROM_MASK(VI_EQ(c,p[i]))),lanes);
+					if (!VF_MOVEMASK(m)){
+						break;
+					}
+					c = VI_BLEND(c,back,VI_FROM_MASK(m));
+				}
+				for (;;){
+					VF e = CROSSING(c,up[i],org[i],inv[i]);
+					VF m = VF_AND(VF_AND(VF_LT(e,lim),VF_LE(e,one)),lanes);
+					if (!VF_MOVEMASK(m)){
+						break;
+					}
+					c = VI_ADD(c,VI_AND(VI_FROM_MASK(m),step[i]));
+				}
+				p[i] = VI_BLEND(p[i],c,VI_FROM_MASK(lanes));
+				next[i] = VF_BLEND(next[i],CROSSING(p[i],up[i],org[i],inv[i]),lanes);
+			}
+		}
+
+		VF d = huge;
+		index = VI_SET1(0);
+		for (int i = 0; i < 3; i++){
+			VF m = VF_LT(next[i],d);
+			d = VF_BLEND(d,next[i],m);
+			index = VI_BLEND(index,VI_SET1(i),VI_FROM_MASK(m));
+		}
+		t = next[0];
+		for (int i = 0; i < 3; i++){
+			VF sel = VF_FROM_MASK(VI_EQ(index,VI_SET1(i)));
+			if (i){
+				t = VF_BLEND(t,next[i],sel);
+			}
+			p[i] = VI_ADD(p[i],VI_AND(VI_FROM_MASK(sel),step[i]));
+			next[i] = VF_BLEND(next[i],CROSSING(p[i],up[i],org[i],inv[i]),sel);
+		}
+	}
+}
+
+#undef CROSSING
+#undef BRICK_LAST
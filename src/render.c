@@ -0,0 +1,809 @@
+#include "render.h"
+#include "raycast.h"
+#include "light_cache.h"
+#include "light_volume.h"
+#include "profile.h"
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+int screen_width, screen_height;
+color_t *screen;
+uint8_t *screen_packed;
+render_output_t screen_output;
+//the frame being traced, and where it's resolved to
+static hdr_color_t *radiance;
+static color_t *back;
+static uint8_t *back_packed;
+
+char *render_output_names[RENDER_OUTPUT_COUNT] = {
+	"rgba",
+	"cga",
+	"cga4",
+};
+render_output_t render_output;
+bool render_dither = true;
+
+render_thread_stats_t render_stats[POOL_MAX_THREADS];
+
+void render_reset_stats(void){
+	memset(render_stats,0,sizeof(render_stats));
+}
+
+#define TILE_SIZE 8
+#define RESOLVE_ROWS 4
+int tiles_x, tiles_y;
+
+struct {
+	vec3 eye, ray, right, up;
+	float cam_w, cam_h;
+	//per frame ray tables: a pixel's ray is (columns[x] + rows[y] + ray) * RAY_LENGTH.
+	//padded to four floats so a pixel's ray takes three sse operations.
+	vec4 *columns, *rows;
+} camera;
+
+#define RAY_LENGTH 100.0f //primary rays reach this many blocks
+
+//smallest contribution of a light, in 0-255 color units, that is worth a shadow ray.
+//with the 1/(d/range+1)^2 falloff this puts a hard radius around every light.
+#define LIGHT_CUTOFF 16.0f
+
+//the lights as the frame sees them, the fill workers never read the sim's
+typedef struct {
+	vec3 position;
+	float radius; //negative if the light never reaches the cutoff
+	color_t color;
+	float range;
+} frame_light_t;
+
+frame_light_t frame_lights[COUNT(lights)];
+uint64_t resting_lights;
+bool render_light_cache = true;
+bool render_temporal;
+bool render_textures = true;
+bool render_beams = true;
+char *render_lighting_names[RENDER_LIGHTING_COUNT] = {
+	"rays",
+	"flood",
+};
+render_lighting_t render_lighting;
+//the settings the frame being traced started with
+bool frame_temporal, frame_light_cache, frame_dither, frame_textures, frame_beams;
+render_lighting_t frame_lighting;
+render_output_t frame_output;
+_Static_assert(COUNT(lights) <= 64,"tile light masks are 64 bit");
+uint64_t *tile_lights;
+bool *tile_relight; //temporal mode reshades these tiles from scratch
+int frame_light_count; //lights culled by the previous cull_lights
+
+//order lights are shaded in. the first base_light_count make up the color temporal mode keeps
+//per pixel, the rest are added on top every frame.
+int shade_order[COUNT(lights)];
+int base_light_count;
+
+void setup_camera(float aspect){
+	sim_get_eye_ray(camera.eye,camera.ray);
+	float fov = 90.0f;
+	camera.cam_h = 2.0f * tanf(fov * 0.5f * (float)M_PI / 180);
+	camera.cam_w = camera.cam_h * aspect;
+	vec3_cross(camera.ray,(vec3){0,1,0},camera.right);
+	vec3_normalize(camera.right,camera.right);
+	vec3_cross(camera.right,camera.ray,camera.up);
+	for (int x = 0; x < screen_width; x++){
+		float cx = ((2 * (x + 0.5f) / screen_width) - 1) * camera.cam_w;
+		vec3_scale(camera.right,cx,camera.columns[x]);
+		camera.columns[x][3] = 0;
+	}
+	for (int y = 0; y < screen_height; y++){
+		float cy = ((2 * (y + 0.5f) / screen_height) - 1) * camera.cam_h;
+		vec3_scale(camera.up,cy,camera.rows[y]);
+		camera.rows[y][3] = 0;
+	}
+}
+
+//screen space extent, at depth 1, of a sphere along one camera axis. c and z are the center's
+//offset along that axis and along the view direction. bounds the sphere by its box, so z-r must be positive.
+static void sphere_extent(float c, float z, float r, float *lo, float *hi){
+	*lo = (c - r) / (c - r <= 0 ? z - r : z + r);
+	*hi = (c + r) / (c + r >= 0 ? z - r : z + r);
+}
+
+static int to_pixel(float u, float half_extent, int size){
+	return (int)floorf((u / half_extent + 1) * size * 0.5f);
+}
+
+//pixel rectangle a light's sphere can touch, false if it is entirely behind the camera
+static bool sphere_pixels(vec3 center, float radius, int *x0, int *y0, int *x1, int *y1){
+	vec3 d;
+	vec3_sub(center,camera.eye,d);
+	float z = vec3_dot(d,camera.ray);
+	*x0 = 0, *y0 = 0, *x1 = screen_width-1, *y1 = screen_height-1;
+	if (z - radius > 0.01f){
+		float ulo, uhi, vlo, vhi;
+		sphere_extent(vec3_dot(d,camera.right),z,radius,&ulo,&uhi);
+		sphere_extent(vec3_dot(d,camera.up),z,radius,&vlo,&vhi);
+		//a pixel of slack for the offset shadow ray origins
+		*x0 = MAX(*x0,to_pixel(ulo,camera.cam_w,screen_width)-1);
+		*x1 = MIN(*x1,to_pixel(uhi,camera.cam_w,screen_width)+1);
+		*y0 = MAX(*y0,to_pixel(vlo,camera.cam_h,screen_height)-1);
+		*y1 = MIN(*y1,to_pixel(vhi,camera.cam_h,screen_height)+1);
+	} else if (z + radius < 0){
+		return false;
+	}
+	return *x0 <= *x1 && *y0 <= *y1;
+}
+
+static void mark_relight(vec3 center, float radius){
+	int x0, y0, x1, y1;
+	if (radius < 0 || !sphere_pixels(center,radius,&x0,&y0,&x1,&y1)){
+		return;
+	}
+	for (int ty = y0/TILE_SIZE; ty <= y1/TILE_SIZE; ty++){
+		for (int tx = x0/TILE_SIZE; tx <= x1/TILE_SIZE; tx++){
+			tile_relight[ty*tiles_x+tx] = true;
+		}
+	}
+}
+
+//once per frame: find each light's cutoff radius and mark the tiles its sphere can touch. the
+//light caches read the world's change log here, and it is cleared once they all have.
+void cull_lights(void){
+	vec3 positions[COUNT(lights)];
+	float radii[COUNT(lights)], ranges[COUNT(lights)];
+	color_t colors[COUNT(lights)];
+	frame_light_t previous[COUNT(lights)];
+	memcpy(previous,frame_lights,sizeof(previous));
+	memset(tile_lights,0,tiles_x*tiles_y*sizeof(*tile_lights));
+	int count = sim_view->light_count;
+	for (int i = 0; i < count; i++){
+		light_snapshot_t *l = sim_view->lights+i;
+		frame_light_t *fl = frame_lights+i;
+		vec3_lerp(l->previous_position,l->current_position,(float)interpolant,fl->position);
+		fl->color = l->color;
+		fl->range = l->range;
+		float brightest = MAX(l->color.r,MAX(l->color.g,l->color.b));
+		fl->radius = brightest >= LIGHT_CUTOFF ? l->range * (sqrtf(brightest / LIGHT_CUTOFF) - 1.0f) : -1.0f;
+		int x0, y0, x1, y1;
+		if (fl->radius < 0 || !sphere_pixels(fl->position,fl->radius,&x0,&y0,&x1,&y1)){
+			continue;
+		}
+		for (int ty = y0/TILE_SIZE; ty <= y1/TILE_SIZE; ty++){
+			for (int tx = x0/TILE_SIZE; tx <= x1/TILE_SIZE; tx++){
+				tile_lights[ty*tiles_x+tx] |= 1ull << i;
+			}
+		}
+	}
+	for (int i = 0; i < count; i++){
+		vec3_copy(frame_lights[i].position,positions[i]);
+		radii[i] = frame_lights[i].radius;
+		colors[i] = frame_lights[i].color;
+		ranges[i] = frame_lights[i].range;
+	}
+	//the volume isn't kept up while rays light the frame
+	if (frame_lighting == RENDER_LIGHTING_FLOOD){
+		light_volume_update(count,positions,colors,ranges);
+	} else {
+		light_volume_invalidate();
+	}
+	uint64_t was_resting = resting_lights;
+	resting_lights = light_cache_update(count,positions,radii);
+	//both have seen the changes since the last frame
+	world_clear_changes();
+
+	//only resting lights are part of the kept color, so a light entering or leaving that set
+	//invalidates the tiles it reaches, at its old position for one that started moving.
+	memset(tile_relight,0,tiles_x*tiles_y*sizeof(*tile_relight));
+	base_light_count = 0;
+	for (int i = 0; i < count; i++){
+		bool resting = resting_lights & (1ull << i);
+		if (resting && !(was_resting & (1ull << i))){
+			mark_relight(frame_lights[i].position,frame_lights[i].radius);
+		} else if (!resting && i < frame_light_count && (was_resting & (1ull << i))){
+			mark_relight(previous[i].position,previous[i].radius);
+		}
+		if (resting || !frame_temporal){
+			shade_order[base_light_count++] = i;
+		}
+	}
+	for (int i = 0, n = base_light_count; i < count; i++){
+		if (!(resting_lights & (1ull << i)) && frame_temporal){
+			shade_order[n++] = i;
+		}
+	}
+	frame_light_count = count;
+}
+
+//temporal mode keeps every pixel's shadow ray origin and its color from the resting lights.
+//each frame the previous points are splatted into the new view, nearest first, and only pixels
+//that received nothing, sit in a relit tile, or are due for their periodic refresh get traced
+//and shaded again. the rest only add the moving lights on top of their kept color.
+#define TEMPORAL_REFRESH 8 //every pixel is reshaded at least once in this many frames
+
+typedef struct {
+	vec3 position;
+	hdr_color_t color;
+	color_t albedo;
+	bool valid;
+} history_t;
+
+history_t *history[2];
+history_t *frame_history; //this frame's, filled in by reproject and fill
+float *history_depth;
+unsigned frame_index;
+bool history_current; //frame_history was filled in by the previous frame
+
+static void reproject(bool invalidate){
+	history_t *previous = frame_history;
+	frame_history = history[frame_history == history[0]];
+	for (int i = 0; i < screen_width*screen_height; i++){
+		frame_history[i].valid = false;
+		history_depth[i] = INFINITY;
+	}
+	if (invalidate){
+		return;
+	}
+	for (int i = 0; i < screen_width*screen_height; i++){
+		if (!previous[i].valid){
+			continue;
+		}
+		vec3 d;
+		vec3_sub(previous[i].position,camera.eye,d);
+		float z = vec3_dot(d,camera.ray);
+		if (z < 0.01f){
+			continue;
+		}
+		int x = to_pixel(vec3_dot(d,camera.right) / z,camera.cam_w,screen_width);
+		int y = to_pixel(vec3_dot(d,camera.up) / z,camera.cam_h,screen_height);
+		if (x < 0 || x >= screen_width || y < 0 || y >= screen_height){
+			continue;
+		}
+		int j = y*screen_width+x;
+		if (z < history_depth[j]){
+			history_depth[j] = z;
+			frame_history[j] = previous[i];
+		}
+	}
+}
+
+//pixels of a 4x2 block take turns being refreshed
+static bool refresh_due(int x, int y){
+	return (unsigned)((y & 1) << 2 | (x & 3)) == frame_index % TEMPORAL_REFRESH;
+}
+
+//block textures. each 16x16 tile is stored on its own with its texels in morton order,
+//so a 4x4 patch of texels, about what neighbouring rays land on, shares a cache line.
+#define ATLAS_TILES 16 //per side
+#define TILE_TEXELS 16 //per side
+#define TILE_SIZE_TEXELS (TILE_TEXELS*TILE_TEXELS)
+
+typedef struct {
+	uint8_t top, side, bottom; //tiles, row*ATLAS_TILES + column
+} material_t;
+
+//by block type. types without an entry show tile 0.
+static material_t materials[256] = {
+	[BLOCK_STONE] = {1,1,1},
+	[BLOCK_GRASS] = {16,32,48},
+	[BLOCK_DIRT] = {48,48,48},
+	[BLOCK_PLANKS] = {50,50,50},
+	[BLOCK_BRICKS] = {18,18,18},
+	[BLOCK_LOG] = {33,49,33},
+	[BLOCK_COBBLESTONE] = {2,2,2},
+	[BLOCK_SAND] = {3,3,3},
+	[BLOCK_GOLD] = {35,35,35},
+};
+
+static color_t *atlas;
+
+static int spread_bits(int v){
+	v = (v | v << 2) & 0x33;
+	return (v | v << 1) & 0x55;
+}
+
+//the texel of the hit face under p. u runs along x (z on the x faces), v down the sides
+//and along z on the top and bottom, so the tiles are upright on the walls.
+static color_t sample_atlas(block_raycast_result_t *hit, vec3 p){
+	material_t *m = materials + *hit->block;
+	int axis = hit->face_normal[0] ? 0 : hit->face_normal[1] ? 1 : 2;
+	int tile = axis != 1 ? m->side : hit->face_normal[1] > 0 ? m->top : m->bottom;
+	float u = p[axis == 0 ? 2 : 0], v = axis == 1 ? p[2] : -p[1];
+	//the fraction can round up to 1 just below a block boundary
+	int tu = MIN((int)((u - floorf(u)) * TILE_TEXELS),TILE_TEXELS-1);
+	int tv = MIN((int)((v - floorf(v)) * TILE_TEXELS),TILE_TEXELS-1);
+	return atlas[tile*TILE_SIZE_TEXELS + (spread_bits(tu) | spread_bits(tv) << 1)];
+}
+
+static void apply_albedo(hdr_color_t *c, color_t albedo){
+	c->r *= albedo.r * (1.0f / 255);
+	c->g *= albedo.g * (1.0f / 255);
+	c->b *= albedo.b * (1.0f / 255);
+}
+
+static void add_light(hdr_color_t *c, frame_light_t *l, float visibility, float dist){
+	float len = dist/l->range + 1.0f;
+	float brightness = visibility * (1.0f / (len * len));
+	c->r += brightness * l->color.r;
+	c->g += brightness * l->color.g;
+	c->b += brightness * l->color.b;
+}
+
+//adds shade_order[first..last) to the packet's hit points. hits may be 0 when none of
+//those lights are resting, it's only needed for the face cache.
+static void shade(int count, vec3 *pos, block_raycast_result_t *hits, hdr_color_t *c, uint64_t tile_mask, int first, int last, render_thread_stats_t *stats){
+	for (int o = first; o < last; o++){
+		int i = shade_order[o];
+		if (!(tile_mask & (1ull << i))){
+			continue;
+		}
+		//only the lanes inside the light's cutoff radius are shaded. resting lights
+		//take their visibility from the face cache, moving ones trace from the pixel.
+		frame_light_t *fl = frame_lights+i;
+		bool cached = frame_light_cache && (resting_lights & (1ull << i));
+		vec3 from[RAY_PACKET_MAX], to_light[RAY_PACKET_MAX];
+		float dist[RAY_PACKET_MAX];
+		int lanes[RAY_PACKET_MAX];
+		int n = 0;
+		for (int h = 0; h < count; h++){
+			vec3_sub(fl->position,pos[h],to_light[n]);
+			dist[n] = vec3_length(to_light[n]);
+			if (dist[n] > fl->radius){
+				continue;
+			}
+			if (cached){
+				block_raycast_result_t *hit = hits+h;
+				int visibility = light_cache_lookup(hit,i);
+				if (visibility < 0){
+					vec3 points[4], rays[4];
+					block_raycast_result_t brr2[4];
+					light_cache_sample_points(hit,points);
+					for (int k = 0; k < 4; k++){
+						vec3_sub(fl->position,points[k],rays[k]);
+					}
+					cast_ray_packet_into_blocks(4,points,rays,brr2);
+					stats->shadow_rays += 4;
+					visibility = 0;
+					for (int k = 0; k < 4; k++){
+						visibility |= !brr2[k].block << k;
+					}
+					light_cache_store(hit,i,visibility);
+				} else {
+					stats->cached_shadows++;
+				}
+				add_light(c+h,fl,light_cache_visibility(hit,pos[h],visibility),dist[n]);
+			} else {
+				vec3_copy(pos[h],from[n]);
+				lanes[n++] = h;
+			}
+		}
+		if (!n){
+			continue;
+		}
+		block_raycast_result_t brr2[RAY_PACKET_MAX];
+		cast_ray_packet_into_blocks(n,from,to_light,brr2);
+		stats->shadow_rays += n;
+		for (int k = 0; k < n; k++){
+			add_light(c+lanes[k],fl,brr2[k].block ? 0.0f : 1.0f,dist[k]);
+		}
+	}
+}
+
+//bricks this close to a beam's box count as touched, it covers the rounding of the rays inside
+#define BEAM_MARGIN (1.0f/16)
+
+//every primary ray of a tile lies between the rays of its corner pixels. that beam is marched a
+//brick length at a time, and the first step whose box touches a brick that isn't empty is where
+//the tile's rays can start: all they pass through before it is air, so starting there instead of
+//at the eye changes none of their results.
+static float beam_start(int x0, int y0, int x1, int y1){
+	vec3 corners[4];
+	int cx[4] = {x0,x1-1,x0,x1-1}, cy[4] = {y0,y0,y1-1,y1-1};
+	tm_simd_t ray = tm_load3(camera.ray), length = tm_splat(RAY_LENGTH);
+	float longest = 0;
+	for (int i = 0; i < 4; i++){
+		tm_store3(corners[i],tm_mul(tm_add(tm_add(tm_load4(camera.columns[cx[i]]),tm_load4(camera.rows[cy[i]])),ray),length));
+		longest = MAX(longest,vec3_length(corners[i]));
+	}
+	float dt = BRICK_WIDTH / longest;
+	for (float t0 = 0; t0 < 1.0f; t0 += dt){
+		float t1 = MIN(t0+dt,1.0f);
+		int lo[3], hi[3];
+		for (int a = 0; a < 3; a++){
+			float mn = INFINITY, mx = -INFINITY;
+			for (int i = 0; i < 4; i++){
+				float e0 = camera.eye[a] + t0*corners[i][a], e1 = camera.eye[a] + t1*corners[i][a];
+				mn = MIN(mn,MIN(e0,e1));
+				mx = MAX(mx,MAX(e0,e1));
+			}
+			lo[a] = (int)floorf(mn - BEAM_MARGIN) >> BRICK_SHIFT;
+			hi[a] = (int)floorf(mx + BEAM_MARGIN) >> BRICK_SHIFT;
+		}
+		for (int by = lo[1]; by <= hi[1]; by++){
+			for (int bz = lo[2]; bz <= hi[2]; bz++){
+				for (int bx = lo[0]; bx <= hi[0]; bx++){
+					if (!brick_is_empty(bx,by,bz)){
+						return t0;
+					}
+				}
+			}
+		}
+	}
+	return 1.0f;
+}
+
+void fill(int x0, int y0, int x1, int y1, int thread_index, void *data){
+	uint64_t t = profile_begin();
+	render_thread_stats_t stats = {0};
+	int tile = (y0/TILE_SIZE)*tiles_x + x0/TILE_SIZE;
+	uint64_t tile_mask = tile_lights[tile];
+	float start = -1; //the beam's, once a pixel of the tile is traced
+	for (int y = y0; y < y1; y++){
+		//pixels that get traced this frame, and the ones that keep their reprojected base color
+		int xs[TILE_SIZE], kept[TILE_SIZE];
+		int trace_count = 0, kept_count = 0;
+		for (int x = x0; x < x1; x++){
+			history_t *h = frame_history + y*screen_width+x;
+			if (!frame_temporal || !h->valid || tile_relight[tile] || refresh_due(x,y)){
+				xs[trace_count++] = x;
+			} else {
+				kept[kept_count++] = x;
+			}
+		}
+		//same operations in the same order as computing the ray from scratch, so the rays are exact
+		tm_simd_t row = tm_load4(camera.rows[y]), ray = tm_load3(camera.ray), length = tm_splat(RAY_LENGTH);
+		if (trace_count && start < 0){
+			start = frame_beams ? beam_start(x0,y0,x1,y1) : 0;
+		}
+		for (int px = 0; px < trace_count; px += RAY_PACKET_MAX){
+			int count = MIN(RAY_PACKET_MAX,trace_count-px);
+			vec3 origins[RAY_PACKET_MAX], dirs[RAY_PACKET_MAX];
+			block_raycast_result_t brr[RAY_PACKET_MAX];
+			for (int l = 0; l < count; l++){
+				tm_store3(dirs[l],tm_mul(tm_add(tm_add(tm_load4(camera.columns[xs[px+l]]),row),ray),length));
+				vec3_copy(camera.eye,origins[l]);
+			}
+			cast_ray_packet_into_blocks_from(count,origins,dirs,start,brr);
+			stats.primary_rays += count;
+
+			//shadow rays of the lanes that hit go out as one packet per light
+			int hits[RAY_PACKET_MAX];
+			int hit_count = 0;
+			vec3 pos[RAY_PACKET_MAX];
+			block_raycast_result_t hit_brr[RAY_PACKET_MAX];
+			hdr_color_t c[RAY_PACKET_MAX];
+			color_t albedo[RAY_PACKET_MAX];
+			for (int l = 0; l < count; l++){
+				if (frame_temporal){
+					frame_history[y*screen_width+xs[px+l]].valid = false;
+				}
+				radiance[y*screen_width+xs[px+l]] = (hdr_color_t){0};
+				if (brr[l].block){
+					vec3 d;
+					vec3_scale(dirs[l],brr[l].t,d);
+					vec3_add(camera.eye,d,pos[hit_count]);
+					for (int i = 0; i < 3; i++){
+						if (brr[l].face_normal[i]){
+							pos[hit_count][i] += brr[l].face_normal[i] * 0.0001f;
+							break;
+						}
+					}
+					hit_brr[hit_count] = brr[l];
+					c[hit_count] = (hdr_color_t){0};
+					//white without textures, so the history never keeps an albedo that wasn't sampled
+					albedo[hit_count] = frame_textures ? sample_atlas(brr+l,pos[hit_count]) : (color_t){255,255,255,255};
+					hits[hit_count++] = l;
+				}
+			}
+			if (frame_lighting == RENDER_LIGHTING_FLOOD){
+				for (int h = 0; h < hit_count; h++){
+					c[h] = light_volume_shade(hit_brr+h);
+				}
+			} else {
+				shade(hit_count,pos,hit_brr,c,tile_mask,0,base_light_count,&stats);
+			}
+			if (frame_temporal){
+				for (int h = 0; h < hit_count; h++){
+					history_t *hist = frame_history + y*screen_width+xs[px+hits[h]];
+					vec3_copy(pos[h],hist->position);
+					hist->color = c[h];
+					hist->albedo = albedo[h];
+					hist->valid = true;
+				}
+			}
+			shade(hit_count,pos,0,c,tile_mask,base_light_count,frame_light_count,&stats);
+			for (int h = 0; h < hit_count; h++){
+				if (frame_textures){
+					apply_albedo(c+h,albedo[h]);
+				}
+				radiance[y*screen_width+xs[px+hits[h]]] = c[h];
+			}
+		}
+		for (int px = 0; px < kept_count; px += RAY_PACKET_MAX){
+			int count = MIN(RAY_PACKET_MAX,kept_count-px);
+			vec3 pos[RAY_PACKET_MAX];
+			hdr_color_t c[RAY_PACKET_MAX];
+			color_t albedo[RAY_PACKET_MAX];
+			for (int l = 0; l < count; l++){
+				history_t *hist = frame_history + y*screen_width+kept[px+l];
+				vec3_copy(hist->position,pos[l]);
+				c[l] = hist->color;
+				albedo[l] = hist->albedo;
+			}
+			shade(count,pos,0,c,tile_mask,base_light_count,frame_light_count,&stats);
+			for (int l = 0; l < count; l++){
+				if (frame_textures){
+					apply_albedo(c+l,albedo[l]);
+				}
+				radiance[y*screen_width+kept[px+l]] = c[l];
+			}
+			stats.reprojected_pixels += count;
+		}
+	}
+	render_thread_stats_t *s = render_stats+thread_index;
+	s->primary_rays += stats.primary_rays;
+	s->shadow_rays += stats.shadow_rays;
+	s->cached_shadows += stats.cached_shadows;
+	s->reprojected_pixels += stats.reprojected_pixels;
+	profile_end("fill",t);
+}
+
+//tonemaps and quantizes a run of rows into the frame's output
+static void resolve(int job_index, int thread_index, void *data){
+	uint64_t t = profile_begin();
+	int y0 = job_index*RESOLVE_ROWS, y1 = MIN(y0+RESOLVE_ROWS,screen_height);
+	for (int y = y0; y < y1; y++){
+		hdr_color_t *in = radiance + y*screen_width;
+		switch (frame_output){
+			case RENDER_OUTPUT_RGBA: tonemap_rgba(in,back + y*screen_width,screen_width); break;
+			case RENDER_OUTPUT_CGA: tonemap_cga(in,back + y*screen_width,screen_width,y,frame_dither); break;
+			default: tonemap_cga_packed(in,back_packed + y*((screen_width+1)/2),screen_width,y,frame_dither); break;
+		}
+	}
+	profile_end("resolve",t);
+}
+
+bool frame_in_flight; //between render_frame_begin and render_frame_end
+
+static int get_packed_index(uint8_t *packed, int width, int x, int y){
+	uint8_t b = packed[y*((width+1)/2) + x/2];
+	return x & 1 ? b >> 4 : b & 15;
+}
+
+static void set_packed_index(uint8_t *packed, int width, int x, int y, int index){
+	uint8_t *b = packed + y*((width+1)/2) + x/2;
+	*b = x & 1 ? (*b & 15) | index << 4 : (*b & 0xf0) | index;
+}
+
+void render_plot_cga(int x, int y, int index){
+	if (screen_output == RENDER_OUTPUT_CGA_PACKED){
+		set_packed_index(screen_packed,screen_width,x,y,index);
+	} else {
+		screen[y*screen_width+x] = cga_colors[index];
+	}
+}
+
+bool render_set_atlas(uint32_t *pixels, int width, int height){
+	ASSERT(!frame_in_flight);
+	if (width != ATLAS_TILES*TILE_TEXELS || height != ATLAS_TILES*TILE_TEXELS){
+		return false;
+	}
+	if (!atlas){
+		atlas = malloc(width*height*sizeof(*atlas));
+		ASSERT(atlas);
+	}
+	for (int y = 0; y < height; y++){
+		for (int x = 0; x < width; x++){
+			int tile = (y/TILE_TEXELS)*ATLAS_TILES + x/TILE_TEXELS;
+			int texel = spread_bits(x % TILE_TEXELS) | spread_bits(y % TILE_TEXELS) << 1;
+			memcpy(atlas + tile*TILE_SIZE_TEXELS + texel,pixels + y*width+x,sizeof(*atlas));
+		}
+	}
+	return true;
+}
+
+//64 byte aligned so a table's reads never straddle a cache line. the contents aren't kept.
+static void *realloc_aligned(void *p, size_t size){
+#ifdef _WIN32
+	_aligned_free(p);
+	return _aligned_malloc(size,64);
+#else
+	free(p);
+	return aligned_alloc(64,(size+63) & ~(size_t)63);
+#endif
+}
+
+void render_set_resolution(int width, int height){
+	ASSERT(width > 0 && height > 0 && !frame_in_flight);
+	if (width == screen_width && height == screen_height){
+		return;
+	}
+	//the finished frame is scaled to the new size, so whoever is still showing it doesn't flash
+	int packed_row = (width+1)/2;
+	color_t *scaled = calloc(width*height,sizeof(*scaled));
+	uint8_t *scaled_packed = calloc(packed_row*height,1);
+	ASSERT(scaled && scaled_packed);
+	for (int y = 0; y < height && screen; y++){
+		for (int x = 0; x < width; x++){
+			int sx = x*screen_width/width, sy = y*screen_height/height;
+			scaled[y*width+x] = screen[sy*screen_width+sx];
+			set_packed_index(scaled_packed,width,x,y,get_packed_index(screen_packed,screen_width,sx,sy));
+		}
+	}
+	free(screen);
+	free(screen_packed);
+	screen = scaled;
+	screen_packed = scaled_packed;
+	screen_width = width;
+	screen_height = height;
+	tiles_x = (width+TILE_SIZE-1)/TILE_SIZE;
+	tiles_y = (height+TILE_SIZE-1)/TILE_SIZE;
+	radiance = realloc(radiance,width*height*sizeof(*radiance));
+	back = realloc(back,width*height*sizeof(*back));
+	back_packed = realloc(back_packed,packed_row*height);
+	tile_lights = realloc(tile_lights,tiles_x*tiles_y*sizeof(*tile_lights));
+	tile_relight = realloc(tile_relight,tiles_x*tiles_y*sizeof(*tile_relight));
+	for (int i = 0; i < 2; i++){
+		history[i] = realloc(history[i],width*height*sizeof(*history[i]));
+	}
+	history_depth = realloc(history_depth,width*height*sizeof(*history_depth));
+	camera.columns = realloc_aligned(camera.columns,width*sizeof(*camera.columns));
+	camera.rows = realloc_aligned(camera.rows,height*sizeof(*camera.rows));
+	ASSERT(radiance && back && back_packed && tile_lights && tile_relight && history[0] && history[1] && history_depth && camera.columns && camera.rows);
+	memset(radiance,0,width*height*sizeof(*radiance));
+	memset(back,0,width*height*sizeof(*back));
+	memset(back_packed,0,packed_row*height);
+	frame_history = history[0];
+	history_current = false;
+}
+
+float render_target_fill_ms;
+float render_fill_ms;
+
+//steps the width by RESOLUTION_STEP, keeping the default aspect. fill time goes with the pixel
+//count, so the new width is picked from the square root of how far off the target we are.
+//after a change the average restarts so the next decision sees the new resolution.
+#define RESOLUTION_STEP 16
+#define RESOLUTION_MIN_WIDTH 64
+#define RESOLUTION_MAX_WIDTH 960
+
+static int next_width; //applied at the start of the next frame, so the finished one stays intact
+
+static void adjust_resolution(float fill_ms){
+	static float average;
+	static int samples;
+	average = samples ? LERP(average,fill_ms,0.1f) : fill_ms;
+	render_fill_ms = average;
+	if (++samples < 10 || (average < render_target_fill_ms * 1.1f && average > render_target_fill_ms * 0.8f)){
+		return;
+	}
+	float scale = sqrtf(render_target_fill_ms / average);
+	int width = (int)roundf(screen_width * scale / RESOLUTION_STEP) * RESOLUTION_STEP;
+	width = CLAMP(width,RESOLUTION_MIN_WIDTH,RESOLUTION_MAX_WIDTH);
+	if (width != screen_width){
+		next_width = width;
+		samples = 0;
+	}
+}
+
+static void start_frame(float aspect){
+	if (!screen){
+		render_set_resolution(DEFAULT_SCREEN_WIDTH,DEFAULT_SCREEN_HEIGHT);
+	}
+	if (next_width){
+		render_set_resolution(next_width,next_width * DEFAULT_SCREEN_HEIGHT / DEFAULT_SCREEN_WIDTH);
+		next_width = 0;
+	}
+	frame_lighting = render_lighting;
+	frame_temporal = render_temporal && frame_lighting == RENDER_LIGHTING_RAYS;
+	frame_light_cache = render_light_cache;
+	frame_output = render_output;
+	frame_dither = render_dither;
+	//the history's albedo is only filled in while textures are on
+	bool textures_changed = frame_textures != (render_textures && atlas);
+	frame_textures = render_textures && atlas;
+	frame_beams = render_beams;
+	tonemap_init();
+	sim_acquire();
+	setup_camera(aspect);
+	//edits and removed lights can change any pixel, so the history is dropped
+	bool invalidate = world_change_count || world_changed_everywhere || sim_view->light_count < frame_light_count || textures_changed;
+	uint64_t t = profile_begin();
+	cull_lights();
+	profile_end("cull lights",t);
+	if (frame_temporal){
+		t = profile_begin();
+		reproject(invalidate || !history_current);
+		profile_end("reproject",t);
+		frame_index++;
+	}
+	history_current = frame_temporal;
+}
+
+static float last_fill_ms;
+
+static void fill_frame(void){
+	uint64_t t0 = get_time();
+	pool_for_tiles(screen_width,screen_height,TILE_SIZE,fill,0);
+	pool_for((screen_height+RESOLVE_ROWS-1)/RESOLVE_ROWS,resolve,0);
+	last_fill_ms = (get_time() - t0) / 1e6f;
+}
+
+static void finish_frame(void){
+	screen_output = frame_output;
+	if (frame_output == RENDER_OUTPUT_CGA_PACKED){
+		uint8_t *p = screen_packed;
+		screen_packed = back_packed;
+		back_packed = p;
+	} else {
+		color_t *c = screen;
+		screen = back;
+		back = c;
+	}
+	if (render_target_fill_ms > 0){
+		adjust_resolution(last_fill_ms);
+	}
+}
+
+void render_frame(float aspect){
+	render_frame_end();
+	start_frame(aspect);
+	fill_frame();
+	finish_frame();
+}
+
+//the pool's caller takes part in the work, so frames are traced from a thread of their own
+//to leave the main thread free for uploading and presenting the previous one.
+struct {
+	thd_thread thread;
+	thd_mutex mutex;
+	thd_condition wake, finished;
+	bool started;
+	bool busy; //guarded by mutex
+} tracer;
+
+static void tracer_thread(void *data){
+	profile_set_thread_name("render");
+	thd_mutex_lock(&tracer.mutex);
+	for (;;){
+		while (!tracer.busy){
+			thd_condition_wait(&tracer.wake,&tracer.mutex);
+		}
+		thd_mutex_unlock(&tracer.mutex);
+		fill_frame();
+		thd_mutex_lock(&tracer.mutex);
+		tracer.busy = false;
+		thd_condition_signal(&tracer.finished);
+	}
+}
+
+void render_frame_begin(float aspect){
+	render_frame_end();
+	if (!tracer.started){
+		tracer.started = true;
+		thd_mutex_init(&tracer.mutex);
+		thd_condition_init(&tracer.wake);
+		thd_condition_init(&tracer.finished);
+		ASSERT(!thd_thread_detach(&tracer.thread,tracer_thread,0));
+	}
+	start_frame(aspect);
+	frame_in_flight = true;
+	thd_mutex_lock(&tracer.mutex);
+	tracer.busy = true;
+	thd_condition_signal(&tracer.wake);
+	thd_mutex_unlock(&tracer.mutex);
+}
+
+void render_frame_end(void){
+	if (!frame_in_flight){
+		return;
+	}
+	uint64_t t = profile_begin();
+	thd_mutex_lock(&tracer.mutex);
+	while (tracer.busy){
+		thd_condition_wait(&tracer.finished,&tracer.mutex);
+	}
+	thd_mutex_unlock(&tracer.mutex);
+	profile_end("render wait",t);
+	frame_in_flight = false;
+	finish_frame();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "sim.h"
+#include "pool.h"
+#include "tonemap.h"
+
+//internal resolution, the frame is scaled up to the window by whole pixels.
+//screen holds the last finished frame and is reallocated whenever the resolution changes.
+#define DEFAULT_SCREEN_WIDTH 160
+#define DEFAULT_SCREEN_HEIGHT 100
+extern int screen_width, screen_height;
+extern color_t *screen;
+
+//light is summed in floats and resolved into the frame once every pixel is shaded
+typedef enum {
+	RENDER_OUTPUT_RGBA, //tonemapped true color in screen
+	RENDER_OUTPUT_CGA, //quantized to cga_colors, still rgba in screen
+	RENDER_OUTPUT_CGA_PACKED, //cga_colors indices in screen_packed, half a byte per pixel
+	RENDER_OUTPUT_COUNT
+} render_output_t;
+
+extern char *render_output_names[RENDER_OUTPUT_COUNT];
+extern render_output_t render_output;
+extern bool render_dither; //ordered dithering for the cga outputs
+extern render_output_t screen_output; //the one the finished frame was resolved with
+extern uint8_t *screen_packed; //(screen_width+1)/2 bytes per row, see tonemap_cga_packed
+
+//sets a pixel of the finished frame to cga_colors[index], whatever its output
+void render_plot_cga(int x, int y, int index);
+
+//per-thread ray counters, accumulated until render_reset_stats.
+typedef struct {
+	_Alignas(64) uint64_t primary_rays;
+	uint64_t shadow_rays;
+	uint64_t cached_shadows; //light visibility served by the face cache instead of a ray
+	uint64_t reprojected_pixels; //pixels the temporal mode carried over from the previous frame
+} render_thread_stats_t;
+extern render_thread_stats_t render_stats[POOL_MAX_THREADS];
+
+//block textures from an atlas of 16x16 tiles of 16x16 texels, rgba with r in the first byte.
+//false if the size doesn't match. until one is set, or with render_textures off, blocks are white.
+bool render_set_atlas(uint32_t *pixels, int width, int height); //between frames
+extern bool render_textures;
+
+//how hits are lit. rays sends a shadow ray to every light in reach, flood reads the block light
+//light_volume.c fills in around the lights: one lookup per hit, but flat per face and approximate.
+typedef enum {
+	RENDER_LIGHTING_RAYS,
+	RENDER_LIGHTING_FLOOD,
+	RENDER_LIGHTING_COUNT
+} render_lighting_t;
+
+extern char *render_lighting_names[RENDER_LIGHTING_COUNT];
+extern render_lighting_t render_lighting; //temporal mode only applies to rays
+
+extern bool render_light_cache;
+extern bool render_temporal; //reuse the previous frame's shading where it reprojects cleanly
+extern bool render_beams; //start each tile's primary rays past the air in front of it
+
+void render_reset_stats(void);
+void render_set_resolution(int width, int height); //between frames
+void render_frame(float aspect);
+
+//render_frame split in two: begin sets the frame up and traces it on a background thread while
+//the caller keeps screen, the previous frame, to itself. end waits and swaps the new frame in.
+//the world must not be streamed or edited in between. render settings and the newest sim
+//snapshot are taken at begin, so the sim can keep ticking.
+void render_frame_begin(float aspect);
+void render_frame_end(void); //does nothing without a frame in flight
+
+//dynamic resolution: with a target set, render_frame averages how long the tiles take to fill
+//and moves the resolution up or down to bring that time to the target. 0 turns it off.
+extern float render_target_fill_ms;
+extern float render_fill_ms; //the running average it steers by
@@ -0,0 +1,94 @@
+#include "replay.h"
+
+static FILE *recording;
+
+bool replay_record_begin(char *path){
+	replay_record_end();
+	recording = fopen(path,"wb");
+	if (!recording){
+		return false;
+	}
+	replay_header_t h = {
+		.version = REPLAY_VERSION,
+		.start = {player.current_position[0],player.current_position[1],player.current_position[2]},
+		.start_pitch = player.head_rotation[0],
+		.start_yaw = player.head_rotation[1],
+	};
+	memcpy(h.magic,REPLAY_MAGIC,sizeof(h.magic));
+	if (fwrite(&h,sizeof(h),1,recording) != 1){
+		replay_record_end();
+		return false;
+	}
+	return true;
+}
+
+void replay_record_tick(void){
+	if (!recording){
+		return;
+	}
+	replay_tick_t t = {
+		.pitch = player.head_rotation[0],
+		.yaw = player.head_rotation[1],
+		.seed = sim_seed,
+		.input =
+			(keys.left ? REPLAY_LEFT : 0) |
+			(keys.right ? REPLAY_RIGHT : 0) |
+			(keys.backward ? REPLAY_BACKWARD : 0) |
+			(keys.forward ? REPLAY_FORWARD : 0) |
+			(keys.jump ? REPLAY_JUMP : 0) |
+			(keys.just_attacked ? REPLAY_SHOOT : 0),
+	};
+	//flushed right away, it's 16 bytes every 50 ms
+	if (fwrite(&t,sizeof(t),1,recording) != 1 || fflush(recording)){
+		replay_record_end();
+	}
+}
+
+void replay_record_end(void){
+	if (recording){
+		fclose(recording);
+		recording = 0;
+	}
+}
+
+bool replay_load(replay_t *r, char *path){
+	memset(r,0,sizeof(*r));
+	FILE *f = fopen(path,"rb");
+	if (!f){
+		return false;
+	}
+	bool ok = fread(&r->header,sizeof(r->header),1,f) == 1
+		&& !memcmp(r->header.magic,REPLAY_MAGIC,sizeof(r->header.magic))
+		&& r->header.version == REPLAY_VERSION
+		&& !fseek(f,0,SEEK_END);
+	long size = ok ? ftell(f) : -1;
+	//a partly written last tick is dropped
+	r->tick_count = size > 0 ? (int)((size - sizeof(r->header)) / sizeof(*r->ticks)) : 0;
+	if (ok && r->tick_count){
+		r->ticks = malloc(r->tick_count*sizeof(*r->ticks));
+		ok = r->ticks && !fseek(f,sizeof(r->header),SEEK_SET)
+			&& fread(r->ticks,sizeof(*r->ticks),r->tick_count,f) == (size_t)r->tick_count;
+	}
+	fclose(f);
+	if (!ok){
+		replay_free(r);
+	}
+	return ok;
+}
+
+void replay_free(replay_t *r){
+	free(r->ticks);
+	memset(r,0,sizeof(*r));
+}
+
+void replay_apply(replay_tick_t *t){
+	player.head_rotation[0] = t->pitch;
+	player.head_rotation[1] = t->yaw;
+	sim_seed = t->seed;
+	keys.left = t->input & REPLAY_LEFT;
+	keys.right = t->input & REPLAY_RIGHT;
+	keys.backward = t->input & REPLAY_BACKWARD;
+	keys.forward = t->input & REPLAY_FORWARD;
+	keys.jump = t->input & REPLAY_JUMP;
+	keys.just_attacked = t->input & REPLAY_SHOOT;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "sim.h"
+
+//input logs. the recorder captures everything tick() reads from outside the sim, the keys, the
+//head rotation and the rng, once per tick. feeding a log back through tick() from the same start
+//replays the session exactly, with no window and as fast as the frames render.
+#define REPLAY_MAGIC "t3dinput"
+#define REPLAY_VERSION 1
+
+enum {
+	REPLAY_LEFT = 1,
+	REPLAY_RIGHT = 2,
+	REPLAY_BACKWARD = 4,
+	REPLAY_FORWARD = 8,
+	REPLAY_JUMP = 16,
+	REPLAY_SHOOT = 32,
+};
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t pad;
+	float start[3]; //the player's position, the rest of the sim starts empty
+	float start_pitch, start_yaw;
+	uint32_t pad2[3];
+} replay_header_t;
+_Static_assert(sizeof(replay_header_t) == 48,"the header is written as is");
+
+//as tick() sees them when it starts
+typedef struct {
+	float pitch, yaw;
+	uint32_t seed;
+	uint32_t input; //REPLAY_* bits
+} replay_tick_t;
+
+typedef struct {
+	replay_header_t header;
+	int tick_count;
+	replay_tick_t *ticks;
+} replay_t;
+
+//the file is appended to every tick, so a session that crashes still leaves a usable log
+bool replay_record_begin(char *path);
+void replay_record_tick(void); //right before tick()
+void replay_record_end(void);
+
+bool replay_load(replay_t *r, char *path);
+void replay_free(replay_t *r);
+void replay_apply(replay_tick_t *t); //sets up the sim for the tick, call tick() after
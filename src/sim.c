@@ -0,0 +1,305 @@
+#include "sim.h"
+#include "raycast.h"
+#include "profile.h"
+#include "replay.h"
+#include "thd.h"
+
+#include <stdatomic.h>
+
+entity_t player = {
+	.width = 0.6f,
+	.height = 1.8f,
+};
+
+light_t lights[MAX_LIGHTS];
+int light_count = 0;
+
+uint32_t sim_seed = 1;
+
+//xorshift32, never leaves or reaches 0 from a nonzero seed
+uint32_t sim_rand(void){
+	sim_seed ^= sim_seed << 13;
+	sim_seed ^= sim_seed >> 17;
+	sim_seed ^= sim_seed << 5;
+	return sim_seed;
+}
+
+static void eye_ray(vec3 position, vec2 head_rotation, vec3 eye, vec3 ray){
+	vec3_copy(position,eye);
+	eye[1] += 1.62f-0.9f;
+	ray[0] = 0.0f;
+	ray[1] = 0.0f;
+	ray[2] = -1.0f;
+	vec3_rotate_deg(ray,(vec3){1,0,0},head_rotation[0],ray);
+	vec3_rotate_deg(ray,(vec3){0,1,0},head_rotation[1],ray);
+}
+
+void get_player_eye_ray(vec3 eye, vec3 ray){
+	vec3 position;
+	get_entity_interpolated_position(&player,position);
+	eye_ray(position,player.head_rotation,eye,ray);
+}
+
+void shoot_light(){
+	shoot_light_from(&player);
+}
+
+void shoot_light_from(entity_t *p){
+	if (light_count == MAX_LIGHTS){
+		return;
+	}
+	//from where the last tick left the player, interpolant belongs to the renderer
+	vec3 eye,ray;
+	eye_ray(p->current_position,p->head_rotation,eye,ray);
+	light_t *light = lights+light_count;
+	light->color.r = sim_rand()%255;
+	light->color.g = sim_rand()%255;
+	light->color.b = sim_rand()%255;
+	light->range = 8.0f;
+	vec3_scale(ray,3.0f,ray);
+	vec3_add(eye,ray,eye);
+	light->entity = add_entity(0.25f,0.25f,eye,ray);
+	light_count++;
+}
+
+/*void get_player_target_block(block_raycast_result_t *result){
+	vec3 head;
+	get_player_head_pos(head);
+	vec3 ray = {0,0,-5};
+	vec3_rotate_deg(ray,(vec3){1,0,0},-player.head_rotation[0],ray);
+	vec3_rotate_deg(ray,(vec3){0,1,0},-player.head_rotation[1],ray);
+	cast_ray_into_blocks(head,ray,result);
+}*/
+
+keys_t keys;
+
+static struct {
+	thd_thread thread;
+	_Atomic bool running;
+	bool remote;
+	uint64_t tick_time; //sim thread only
+
+	//guarded by input_mutex
+	thd_mutex input_mutex;
+	keys_t input;
+	vec2 head_rotation; //also read unguarded by the main thread, the only writer
+
+	thd_mutex world_mutex; //held by the sim thread through every tick
+
+	//triple buffered snapshots. the writer fills its own and swaps it for the published one,
+	//the reader swaps its own for the published one when that is fresh.
+	sim_snapshot_t snapshots[3];
+	_Atomic int published; //index, with SNAPSHOT_FRESH until the reader takes it
+	int writing, reading;
+	uint64_t ticks;
+} sim = {
+	.published = 1,
+	.writing = 0,
+	.reading = 2,
+};
+#define SNAPSHOT_FRESH 4
+
+sim_snapshot_t *sim_view;
+
+static void publish(void){
+	sim_snapshot_t *s = sim.snapshots + sim.writing;
+	s->tick = ++sim.ticks;
+	s->time = sim.tick_time;
+	vec3_copy(player.previous_position,s->previous_position);
+	vec3_copy(player.current_position,s->current_position);
+	s->head_rotation[0] = player.head_rotation[0];
+	s->head_rotation[1] = player.head_rotation[1];
+	s->light_count = light_count;
+	for (int i = 0; i < light_count; i++){
+		light_snapshot_t *ls = s->lights+i;
+		vec3_copy(entities.previous_position[lights[i].entity],ls->previous_position);
+		vec3_copy(entities.current_position[lights[i].entity],ls->current_position);
+		ls->color = lights[i].color;
+		ls->range = lights[i].range;
+	}
+	sim.writing = atomic_exchange(&sim.published,sim.writing | SNAPSHOT_FRESH) & ~SNAPSHOT_FRESH;
+}
+
+sim_snapshot_t *sim_acquire(void){
+	if (atomic_load(&sim.published) & SNAPSHOT_FRESH){
+		sim.reading = atomic_exchange(&sim.published,sim.reading) & ~SNAPSHOT_FRESH;
+	}
+	sim_view = sim.snapshots + sim.reading;
+	if ((sim_running() || sim.remote) && sim_view->time){
+		uint64_t now = get_time();
+		interpolant = now > sim_view->time ? MIN(1.0,(now - sim_view->time) / (SEC_PER_TICK * 1e9)) : 0.0;
+	}
+	return sim_view;
+}
+
+void sim_get_eye_ray(vec3 eye, vec3 ray){
+	vec3 position;
+	vec3_lerp(sim_view->previous_position,sim_view->current_position,(float)interpolant,position);
+	eye_ray(position,sim_running() || sim.remote ? sim.head_rotation : sim_view->head_rotation,eye,ray);
+}
+
+void move_player(entity_t *p, keys_t *k){
+	if (k->just_attacked){
+		k->just_attacked = false;
+		shoot_light_from(p);
+	}
+	ivec2 move_dir;
+	if (k->left && k->right){
+		move_dir[0] = 0;
+	} else if (k->left){
+		move_dir[0] = -1;
+	} else if (k->right){
+		move_dir[0] = 1;
+	} else {
+		move_dir[0] = 0;
+	}
+	if (k->backward && k->forward){
+		move_dir[1] = 0;
+	} else if (k->backward){
+		move_dir[1] = 1;
+	} else if (k->forward){
+		move_dir[1] = -1;
+	} else {
+		move_dir[1] = 0;
+	}
+	vec3 move_vec = {(float)move_dir[0],0,(float)move_dir[1]};
+	if (move_dir[0] || move_dir[1]){
+		vec3_normalize(move_vec,move_vec);
+		vec3_scale(move_vec,0.25f,move_vec);
+		vec3_rotate_deg(move_vec,(vec3){0,1,0},p->head_rotation[1],move_vec);
+	}
+	p->velocity[0] = LERP(p->velocity[0],move_vec[0],0.3f);
+	p->velocity[2] = LERP(p->velocity[2],move_vec[2],0.3f);
+	if (p->on_ground && k->jump){
+		p->velocity[1] = 0.5f;
+	}
+	update_entity(p);
+}
+
+static void step(void){
+	uint64_t t = profile_begin();
+	move_player(&player,&keys);
+	profile_end("player",t);
+	update_entities();
+	publish();
+}
+
+void tick(){
+	step();
+	uint64_t t = profile_begin();
+	world_update(player.current_position);
+	profile_end("world update",t);
+}
+
+static void sleep_ns(uint64_t ns){
+#if _WIN32
+	Sleep((DWORD)(ns / 1000000));
+#else
+	nanosleep(&(struct timespec){.tv_sec = ns / 1000000000, .tv_nsec = ns % 1000000000},0);
+#endif
+}
+
+#define TICK_NS ((uint64_t)(SEC_PER_TICK * 1e9))
+#define MAX_CATCH_UP 5 //ticks behind before the missed ones are dropped instead
+
+static void sim_thread(void *data){
+	profile_set_thread_name("sim");
+	uint64_t next = get_time();
+	while (atomic_load(&sim.running)){
+		uint64_t now = get_time();
+		if (now < next){
+			sleep_ns(next - now);
+			continue;
+		}
+		if (now - next > MAX_CATCH_UP*TICK_NS){
+			next = now;
+		}
+		thd_mutex_lock(&sim.input_mutex);
+		keys = sim.input;
+		sim.input.just_attacked = false;
+		player.head_rotation[0] = sim.head_rotation[0];
+		player.head_rotation[1] = sim.head_rotation[1];
+		thd_mutex_unlock(&sim.input_mutex);
+
+		thd_mutex_lock(&sim.world_mutex);
+		sim.tick_time = next;
+		replay_record_tick();
+		uint64_t t = profile_begin();
+		step();
+		profile_end("tick",t);
+		thd_mutex_unlock(&sim.world_mutex);
+		next += TICK_NS;
+	}
+}
+
+void sim_start(void){
+	ASSERT(!sim_running());
+	thd_mutex_init(&sim.input_mutex);
+	thd_mutex_init(&sim.world_mutex);
+	sim.input = keys;
+	sim.head_rotation[0] = player.head_rotation[0];
+	sim.head_rotation[1] = player.head_rotation[1];
+	publish(); //so the first frame has something to show
+	//the shared pool belongs to the renderer now, physics gets workers of its own
+	static pool_t *sim_pool;
+	if (!sim_pool){
+		sim_pool = pool_create(MAX(1,thd_processor_count()/2),"sim worker");
+	}
+	entity_pool = sim_pool;
+	atomic_store(&sim.running,true);
+	ASSERT(!thd_thread_detach(&sim.thread,sim_thread,0));
+}
+
+void sim_stop(void){
+	if (!sim_running()){
+		return;
+	}
+	atomic_store(&sim.running,false);
+	thd_thread_join(&sim.thread);
+	thd_mutex_destroy(&sim.world_mutex);
+	thd_mutex_destroy(&sim.input_mutex);
+	entity_pool = 0;
+}
+
+bool sim_running(void){
+	return atomic_load(&sim.running);
+}
+
+void sim_set_input(keys_t *k, vec2 head_rotation){
+	thd_mutex_lock(&sim.input_mutex);
+	bool attack = sim.input.just_attacked || k->just_attacked;
+	sim.input = *k;
+	sim.input.just_attacked = attack;
+	sim.head_rotation[0] = head_rotation[0];
+	sim.head_rotation[1] = head_rotation[1];
+	thd_mutex_unlock(&sim.input_mutex);
+}
+
+//without the thread nothing else touches the world
+bool sim_try_lock_world(void){
+	return !sim_running() || !thd_mutex_trylock(&sim.world_mutex);
+}
+
+void sim_unlock_world(void){
+	if (sim_running()){
+		thd_mutex_unlock(&sim.world_mutex);
+	}
+}
+
+void sim_start_remote(void){
+	ASSERT(!sim_running() && !sim.remote);
+	thd_mutex_init(&sim.input_mutex);
+	sim.remote = true;
+}
+
+void sim_stop_remote(void){
+	ASSERT(sim.remote);
+	thd_mutex_destroy(&sim.input_mutex);
+	sim.remote = false;
+}
+
+void sim_receive(sim_snapshot_t *s){
+	ASSERT(sim.remote);
+	sim.snapshots[sim.writing] = *s;
+	sim.writing = atomic_exchange(&sim.published,sim.writing | SNAPSHOT_FRESH) & ~SNAPSHOT_FRESH;
+}
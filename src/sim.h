@@ -0,0 +1,86 @@
+#pragma once
+
+#include "entity.h"
+
+#define TICK_RATE 20.0
+#define SEC_PER_TICK (1.0 / TICK_RATE)
+
+typedef struct {
+	uint8_t r,g,b,a;
+} color_t;
+
+typedef struct {
+	int entity; //in the entity store
+	color_t color;
+	float range;
+} light_t;
+#define MAX_LIGHTS 64 //the renderer keeps a bit per light
+extern light_t lights[MAX_LIGHTS];
+extern int light_count;
+
+extern entity_t player;
+
+typedef struct {
+	bool
+		left,
+		right,
+		backward,
+		forward,
+		jump,
+		crouch,
+		attack,
+		just_attacked,
+		interact,
+		just_interacted;
+} keys_t;
+extern keys_t keys; //just_attacked shoots a light on the next tick
+
+//the sim draws from its own generator, so a recorded session can be replayed exactly
+extern uint32_t sim_seed;
+uint32_t sim_rand(void);
+
+void get_player_eye_ray(vec3 eye, vec3 ray); //the live player, only for whoever runs the ticks
+void shoot_light();
+void shoot_light_from(entity_t *p); //along p's eye ray, for sims with more than one player
+void move_player(entity_t *p, keys_t *k); //p's part of a tick, takes k's just_attacked
+void tick(); //one tick on the calling thread, streaming included
+
+//what the renderer sees of the sim: the state after a tick, with the previous tick's positions
+//to interpolate from. tick() publishes one at its end and the renderer picks up the newest in
+//render_frame_begin, swapping them through an atomic index, so neither waits for the other.
+//a snapshot is never written while it is being read.
+typedef struct {
+	vec3 previous_position, current_position;
+	color_t color;
+	float range;
+} light_snapshot_t;
+
+typedef struct {
+	uint64_t tick; //ticks run before it was taken
+	uint64_t time; //when the sim thread had the tick due, 0 for ticks run by hand
+	vec3 previous_position, current_position; //the player's
+	vec2 head_rotation;
+	int light_count;
+	light_snapshot_t lights[MAX_LIGHTS];
+} sim_snapshot_t;
+
+extern sim_snapshot_t *sim_view; //the one picked up last, 0 before the first
+sim_snapshot_t *sim_acquire(void); //main thread. sets interpolant while the sim thread runs
+void sim_get_eye_ray(vec3 eye, vec3 ray); //sim_view's at interpolant, looking along the latest sim_set_input while the thread runs
+
+//the sim thread ticks at TICK_RATE on its own, so a slow frame doesn't hold up the sim and
+//catch-up ticks don't hold up a frame. while it runs, input goes through sim_set_input rather
+//than keys and player, and the world is streamed by the main thread between frames under
+//sim_try_lock_world. nothing else may touch the sim's state.
+void sim_start(void);
+void sim_stop(void);
+bool sim_running(void);
+void sim_set_input(keys_t *k, vec2 head_rotation); //just_attacked is held until a tick takes it
+bool sim_try_lock_world(void); //fails while a tick is running
+void sim_unlock_world(void);
+
+//a sim that runs somewhere else, see net.h. nothing ticks here, the snapshots come in through
+//sim_receive, and sim_set_input and sim_get_eye_ray work as they do with the thread.
+void sim_start_remote(void);
+void sim_stop_remote(void); //sim_start can follow to carry on locally
+void sim_receive(sim_snapshot_t *s); //main thread, s->time is when it arrived
@@ -57,6 +57,13 @@ int thd_thread_join(thd_thread* thread)
     return 1;
 }
 
+int thd_processor_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
 int thd_mutex_init(thd_mutex* mutex)
 {
     InitializeCriticalSection(mutex);
@@ -98,6 +105,12 @@ int thd_condition_signal(thd_condition* cond)
     return 0;
 }
 
+int thd_condition_broadcast(thd_condition* cond)
+{
+    WakeAllConditionVariable(cond);
+    return 0;
+}
+
 int thd_condition_wait(thd_condition* cond, thd_mutex* mutex)
 {
     return !SleepConditionVariableCS(cond, mutex, INFINITE);
@@ -110,6 +123,8 @@ int thd_condition_destroy(thd_condition* cond)
 
 #else
 
+#include <unistd.h>
+
 int thd_thread_detach(thd_thread* thread, thd_thread_method method, void* data)
 {
     return pthread_create(thread, 0, (void *)method, data);
@@ -120,6 +135,12 @@ int thd_thread_join(thd_thread* thread)
     return pthread_join(*thread, NULL);
 }
 
+int thd_processor_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
 int thd_mutex_init(thd_mutex* mutex)
 {
     return pthread_mutex_init(mutex, NULL);
@@ -155,6 +176,11 @@ int thd_condition_signal(thd_condition* cond)
     return pthread_cond_signal(cond);
 }
 
+int thd_condition_broadcast(thd_condition* cond)
+{
+    return pthread_cond_broadcast(cond);
+}
+
 int thd_condition_wait(thd_condition* cond, thd_mutex* mutex)
 {
     return pthread_cond_wait(cond, mutex);
@@ -52,6 +52,9 @@ THD_EXTERN int thd_thread_detach(thd_thread* thread, thd_thread_method method, v
 //! @brief Joins a thread.
 THD_EXTERN int thd_thread_join(thd_thread* thread);
 
+//! @brief Returns the number of logical processors available to the process.
+THD_EXTERN int thd_processor_count(void);
+
 
 
 
@@ -99,6 +102,9 @@ THD_EXTERN int thd_condition_init(thd_condition* cond);
 //! @brief Restarts one of the threads that are waiting on the condition.
 THD_EXTERN int thd_condition_signal(thd_condition* cond);
 
+//! @brief Restarts all of the threads that are waiting on the condition.
+THD_EXTERN int thd_condition_broadcast(thd_condition* cond);
+
 //! @brief Unlocks the mutex and waits for the condition to be signalled.
 THD_EXTERN int thd_condition_wait(thd_condition* cond, thd_mutex* mutex);
 
@@ -0,0 +1,178 @@
+#include "tonemap.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TONEMAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+color_t cga_colors[] = {
+	{0x00,0x00,0x00,0xFF},
+	{0x00,0x00,0xAA,0xFF},
+	{0x00,0xAA,0x00,0xFF},
+	{0x00,0xAA,0xAA,0xFF},
+	{0xAA,0x00,0x00,0xFF},
+	{0xAA,0x00,0xAA,0xFF},
+	{0xAA,0x55,0x00,0xFF},
+	{0xAA,0xAA,0xAA,0xFF},
+	{0x55,0x55,0x55,0xFF},
+	{0x55,0x55,0xFF,0xFF},
+	{0x55,0xFF,0x55,0xFF},
+	{0x55,0xFF,0xFF,0xFF},
+	{0xFF,0x55,0x55,0xFF},
+	{0xFF,0x55,0xFF,0xFF},
+	{0xFF,0xFF,0x55,0xFF},
+	{0xFF,0xFF,0xFF,0xFF},
+};
+
+//the curve is the identity up to KNEE and compresses everything above into the rest of the range
+#define KNEE 204.0f
+//the palette lookup is a LUT_SIZE^3 grid over tonemapped rgb
+#define LUT_BITS 5
+#define LUT_SIZE (1 << LUT_BITS)
+#define LUT_SCALE ((LUT_SIZE-1) / 255.0f)
+//cga's levels are 0x55 apart, so the dither pattern spans one level
+#define DITHER_SPREAD 85.0f
+#define CHUNK 64 //pixels quantized at once, a multiple of 4 so the dither pattern lines up
+
+static uint8_t lut[LUT_SIZE*LUT_SIZE*LUT_SIZE];
+static bool lut_ready;
+
+static const float bayer[4][4] = {
+	{0,8,2,10},
+	{12,4,14,6},
+	{3,11,1,9},
+	{15,7,13,5},
+};
+
+void tonemap_init(void){
+	if (lut_ready){
+		return;
+	}
+	for (int i = 0; i < COUNT(lut); i++){
+		float c[3] = {
+			(float)(i >> 2*LUT_BITS) / LUT_SCALE,
+			(float)(i >> LUT_BITS & (LUT_SIZE-1)) / LUT_SCALE,
+			(float)(i & (LUT_SIZE-1)) / LUT_SCALE,
+		};
+		float best = INFINITY;
+		for (int p = 0; p < COUNT(cga_colors); p++){
+			float dr = c[0] - cga_colors[p].r, dg = c[1] - cga_colors[p].g, db = c[2] - cga_colors[p].b;
+			float d = dr*dr + dg*dg + db*db;
+			if (d < best){
+				best = d;
+				lut[i] = (uint8_t)p;
+			}
+		}
+	}
+	lut_ready = true;
+}
+
+static float dither_offset(int x, int y){
+	return ((bayer[y & 3][x & 3] + 0.5f) / 16.0f - 0.5f) * DITHER_SPREAD;
+}
+
+//the scalar and sse versions do the same operations in the same order, so they agree exactly
+static float curve(float x){
+	float t = MAX(x - KNEE,0.0f) * (1.0f / (255.0f - KNEE));
+	return MIN(x,KNEE) + (255.0f - KNEE) * t / (1.0f + t);
+}
+
+static int lut_coordinate(float v, float d){
+	return (int)lrintf(CLAMP((v + d) * LUT_SCALE,0.0f,(float)(LUT_SIZE-1)));
+}
+
+int tonemap_nearest_cga(color_t c){
+	return lut[lut_coordinate(c.r,0) << 2*LUT_BITS | lut_coordinate(c.g,0) << LUT_BITS | lut_coordinate(c.b,0)];
+}
+
+#if TONEMAP_SSE2
+static __m128 curve4(__m128 x){
+	__m128 knee = _mm_set1_ps(KNEE);
+	__m128 t = _mm_mul_ps(_mm_max_ps(_mm_sub_ps(x,knee),_mm_setzero_ps()),_mm_set1_ps(1.0f / (255.0f - KNEE)));
+	__m128 shoulder = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(255.0f - KNEE),t),_mm_add_ps(_mm_set1_ps(1.0f),t));
+	return _mm_add_ps(_mm_min_ps(x,knee),shoulder);
+}
+
+static __m128i lut_coordinate4(__m128 v, __m128 d){
+	__m128 q = _mm_mul_ps(_mm_add_ps(v,d),_mm_set1_ps(LUT_SCALE));
+	q = _mm_min_ps(_mm_max_ps(q,_mm_setzero_ps()),_mm_set1_ps((float)(LUT_SIZE-1)));
+	return _mm_cvtps_epi32(q);
+}
+#endif
+
+void tonemap_rgba(hdr_color_t *in, color_t *out, int count){
+	int i = 0;
+#if TONEMAP_SSE2
+	__m128i alpha = _mm_set1_epi32((int)0xff000000);
+	for (; i+4 <= count; i += 4){
+		__m128i p0 = _mm_cvtps_epi32(curve4(_mm_loadu_ps(&in[i].r)));
+		__m128i p1 = _mm_cvtps_epi32(curve4(_mm_loadu_ps(&in[i+1].r)));
+		__m128i p2 = _mm_cvtps_epi32(curve4(_mm_loadu_ps(&in[i+2].r)));
+		__m128i p3 = _mm_cvtps_epi32(curve4(_mm_loadu_ps(&in[i+3].r)));
+		__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(p0,p1),_mm_packs_epi32(p2,p3));
+		_mm_storeu_si128((__m128i *)(out+i),_mm_or_si128(bytes,alpha));
+	}
+#endif
+	for (; i < count; i++){
+		out[i] = (color_t){
+			(uint8_t)lrintf(curve(in[i].r)),
+			(uint8_t)lrintf(curve(in[i].g)),
+			(uint8_t)lrintf(curve(in[i].b)),
+			255
+		};
+	}
+}
+
+//palette indices of up to CHUNK pixels
+static void quantize(hdr_color_t *in, uint8_t *indices, int count, int y, bool dither){
+	int i = 0;
+#if TONEMAP_SSE2
+	__m128 d = dither ?
+		_mm_setr_ps(dither_offset(0,y),dither_offset(1,y),dither_offset(2,y),dither_offset(3,y)) :
+		_mm_setzero_ps();
+	for (; i+4 <= count; i += 4){
+		//four pixels of rgb_ become rgb across four pixels
+		__m128 p0 = curve4(_mm_loadu_ps(&in[i].r));
+		__m128 p1 = curve4(_mm_loadu_ps(&in[i+1].r));
+		__m128 p2 = curve4(_mm_loadu_ps(&in[i+2].r));
+		__m128 p3 = curve4(_mm_loadu_ps(&in[i+3].r));
+		_MM_TRANSPOSE4_PS(p0,p1,p2,p3);
+		__m128i index = _mm_or_si128(
+			_mm_or_si128(_mm_slli_epi32(lut_coordinate4(p0,d),2*LUT_BITS),_mm_slli_epi32(lut_coordinate4(p1,d),LUT_BITS)),
+			lut_coordinate4(p2,d));
+		_Alignas(16) int32_t lanes[4];
+		_mm_store_si128((__m128i *)lanes,index);
+		for (int k = 0; k < 4; k++){
+			indices[i+k] = lut[lanes[k]];
+		}
+	}
+#endif
+	for (; i < count; i++){
+		float d = dither ? dither_offset(i,y) : 0.0f;
+		int index = lut_coordinate(curve(in[i].r),d) << 2*LUT_BITS | lut_coordinate(curve(in[i].g),d) << LUT_BITS | lut_coordinate(curve(in[i].b),d);
+		indices[i] = lut[index];
+	}
+}
+
+void tonemap_cga(hdr_color_t *in, color_t *out, int count, int y, bool dither){
+	for (int i = 0; i < count; i += CHUNK){
+		uint8_t indices[CHUNK];
+		int n = MIN(CHUNK,count-i);
+		quantize(in+i,indices,n,y,dither);
+		for (int k = 0; k < n; k++){
+			out[i+k] = cga_colors[indices[k]];
+		}
+	}
+}
+
+void tonemap_cga_packed(hdr_color_t *in, uint8_t *out, int count, int y, bool dither){
+	for (int i = 0; i < count; i += CHUNK){
+		uint8_t indices[CHUNK+1];
+		int n = MIN(CHUNK,count-i);
+		quantize(in+i,indices,n,y,dither);
+		indices[n] = 0;
+		for (int k = 0; k < n; k += 2){
+			out[(i+k)/2] = indices[k] | indices[k+1] << 4;
+		}
+	}
+}
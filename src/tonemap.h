@@ -0,0 +1,27 @@
+#pragma once
+
+#include "sim.h"
+
+//linear light in 0-255 color units, unbounded. the fourth float pads a pixel to one sse register.
+//the alignment only holds for static and stack pixels, heap buffers are loaded unaligned.
+typedef struct {
+	_Alignas(16) float r;
+	float g, b, pad;
+} hdr_color_t;
+
+extern color_t cga_colors[16];
+
+//builds the table that maps colors to the nearest cga color. once, before any of the below.
+void tonemap_init(void);
+
+//index of the cga color nearest to an already tonemapped color, the cga colors map to themselves
+int tonemap_nearest_cga(color_t c);
+
+//a row of count pixels. values past the knee roll off smoothly towards white instead of clipping.
+void tonemap_rgba(hdr_color_t *in, color_t *out, int count);
+
+//the same, quantized to cga_colors. dither adds a 4x4 ordered pattern, y picks its row.
+void tonemap_cga(hdr_color_t *in, color_t *out, int count, int y, bool dither);
+
+//cga_colors indices, two pixels per byte with the left one in the low nibble.
+void tonemap_cga_packed(hdr_color_t *in, uint8_t *out, int count, int y, bool dither);
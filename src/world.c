@@ -0,0 +1,589 @@
+#include "world.h"
+#include "thd.h"
+#include "profile.h"
+
+#include <time.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+chunk_t *chunk_index[INDEX_WIDTH*INDEX_WIDTH*INDEX_WIDTH];
+int view_distance = 4;
+
+block_box_t world_changes[WORLD_CHANGE_LOG];
+int world_change_count;
+bool world_changed_everywhere;
+
+//once the log is full, further changes grow the last box
+static void log_change(int x0, int y0, int z0, int x1, int y1, int z1){
+	block_box_t *b;
+	if (world_change_count < WORLD_CHANGE_LOG){
+		b = world_changes + world_change_count++;
+		b->min[0] = x0;
+		b->min[1] = y0;
+		b->min[2] = z0;
+		b->max[0] = x1;
+		b->max[1] = y1;
+		b->max[2] = z1;
+	} else {
+		b = world_changes + WORLD_CHANGE_LOG-1;
+		b->min[0] = MIN(b->min[0],x0);
+		b->min[1] = MIN(b->min[1],y0);
+		b->min[2] = MIN(b->min[2],z0);
+		b->max[0] = MAX(b->max[0],x1);
+		b->max[1] = MAX(b->max[1],y1);
+		b->max[2] = MAX(b->max[2],z1);
+	}
+}
+
+static void log_chunk_change(chunk_t *c){
+	log_change(c->x*CHUNK_WIDTH,c->y*CHUNK_WIDTH,c->z*CHUNK_WIDTH,c->x*CHUNK_WIDTH+CHUNK_WIDTH-1,c->y*CHUNK_WIDTH+CHUNK_WIDTH-1,c->z*CHUNK_WIDTH+CHUNK_WIDTH-1);
+}
+
+void world_clear_changes(void){
+	world_change_count = 0;
+	world_changed_everywhere = false;
+}
+
+//resident or still loading
+static chunk_t *lookup_chunk(int cx, int cy, int cz){
+	chunk_t *c = *chunk_slot(cx,cy,cz);
+	return c && c->x == cx && c->y == cy && c->z == cz ? c : 0;
+}
+
+static void rebuild_bricks(chunk_t *c){
+	memset(c->brick_cells,0,sizeof(c->brick_cells));
+	c->brick_mask = 0;
+	for (int y = 0; y < CHUNK_WIDTH; y++){
+		for (int z = 0; z < CHUNK_WIDTH; z++){
+			for (int x = 0; x < CHUNK_WIDTH; x++){
+				if (c->blocks[chunk_block_index(x,y,z)]){
+					int i = chunk_brick_index(x >> BRICK_SHIFT,y >> BRICK_SHIFT,z >> BRICK_SHIFT);
+					c->brick_cells[i] |= cell_bit(x,y,z);
+					c->brick_mask |= 1ull << i;
+				}
+			}
+		}
+	}
+}
+
+//one axis of the separable distance transform: out = min over the line of max(offset, in).
+//stride picks the axis. the search walks outwards and stops once offsets can't win anymore.
+static void distance_pass(uint8_t *in, uint8_t *out, int stride){
+	for (int i = 0; i < CHUNK_VOLUME; i++){
+		int pos = i / stride % CHUNK_WIDTH;
+		uint8_t *line = in + i - pos*stride;
+		int best = in[i];
+		for (int r = 1; r < best; r++){
+			if (pos-r >= 0 && line[(pos-r)*stride] < best){
+				best = MAX(r,line[(pos-r)*stride]);
+			}
+			if (pos+r < CHUNK_WIDTH && line[(pos+r)*stride] < best){
+				best = MAX(r,line[(pos+r)*stride]);
+			}
+		}
+		out[i] = (uint8_t)best;
+	}
+}
+
+static void rebuild_distances(chunk_t *c){
+	if (!c->brick_mask){
+		memset(c->distance,CHUNK_WIDTH,sizeof(c->distance));
+		return;
+	}
+	uint8_t a[CHUNK_VOLUME];
+	for (int i = 0; i < CHUNK_VOLUME; i++){
+		c->distance[i] = c->blocks[i] ? 0 : CHUNK_WIDTH;
+	}
+	distance_pass(c->distance,a,1);
+	distance_pass(a,c->distance,CHUNK_WIDTH);
+	distance_pass(c->distance,a,CHUNK_WIDTH*CHUNK_WIDTH);
+	memcpy(c->distance,a,sizeof(a));
+}
+
+void set_block(int x, int y, int z, block_t b){
+	chunk_t *c = get_chunk(x >> CHUNK_SHIFT,y >> CHUNK_SHIFT,z >> CHUNK_SHIFT);
+	if (!c){
+		return;
+	}
+	c->blocks[chunk_block_index(x,y,z)] = b;
+	c->dirty = true;
+	log_change(x,y,z,x,y,z);
+	int i = chunk_brick_index(x >> BRICK_SHIFT,y >> BRICK_SHIFT,z >> BRICK_SHIFT);
+	if (b){
+		c->brick_cells[i] |= cell_bit(x,y,z);
+	} else {
+		c->brick_cells[i] &= ~cell_bit(x,y,z);
+	}
+	if (c->brick_cells[i]){
+		c->brick_mask |= 1ull << i;
+	} else {
+		c->brick_mask &= ~(1ull << i);
+	}
+	rebuild_distances(c);
+}
+
+//the original 32^3 room sitting on flat ground.
+#define ROOM_WIDTH 32
+
+static block_t generate_block(int x, int y, int z){
+	if (y < 0){
+		return BLOCK_STONE;
+	}
+	if (x < 0 || x >= ROOM_WIDTH || y >= ROOM_WIDTH || z < 0 || z >= ROOM_WIDTH){
+		return BLOCK_AIR;
+	}
+	if (y == 0){
+		return BLOCK_PLANKS;
+	}
+	if (y == ROOM_WIDTH-1){
+		return BLOCK_STONE;
+	}
+	if (x == 0 || x == ROOM_WIDTH-1 || z == 0 || z == ROOM_WIDTH-1){
+		return BLOCK_BRICKS;
+	}
+	return x == 10 && y == 2 && z == 10 ? BLOCK_GOLD : BLOCK_AIR;
+}
+
+static void generate_chunk(chunk_t *c){
+	for (int y = 0; y < CHUNK_WIDTH; y++){
+		for (int z = 0; z < CHUNK_WIDTH; z++){
+			for (int x = 0; x < CHUNK_WIDTH; x++){
+				c->blocks[chunk_block_index(x,y,z)] = generate_block(c->x*CHUNK_WIDTH + x,c->y*CHUNK_WIDTH + y,c->z*CHUNK_WIDTH + z);
+			}
+		}
+	}
+}
+
+//region files, after scaevolus' mcregion: one file per 8^3 chunks, split into 4k sectors.
+//sector 0 is the header: a big endian location (sector offset << 8 | sector count) per chunk,
+//followed by a last-write timestamp per chunk. a chunk is a 4 byte length, a compression
+//byte and the payload, padded to whole sectors. we have no zlib, chunks are run length encoded.
+#define REGION_SHIFT 3
+#define REGION_WIDTH (1 << REGION_SHIFT)
+#define REGION_CHUNKS (REGION_WIDTH*REGION_WIDTH*REGION_WIDTH)
+#define SECTOR_SIZE 4096
+#define COMPRESSION_RLE 1
+#define REGION_CACHE 8
+
+_Static_assert(REGION_CHUNKS*8 == SECTOR_SIZE,"region header is one sector");
+
+typedef struct {
+	int x, y, z;
+	FILE *file;
+	uint32_t locations[REGION_CHUNKS];
+	uint32_t timestamps[REGION_CHUNKS];
+	uint8_t *used; //per sector
+	int sector_count;
+	uint64_t last_use;
+} region_t;
+
+static uint32_t read_be32(uint8_t *p){
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void write_be32(uint8_t *p, uint32_t v){
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static struct {
+	char region_dir[256]; //fixed while the io thread runs
+
+	//io thread only
+	region_t regions[REGION_CACHE];
+	uint64_t use_counter;
+
+	//guarded by mutex
+	thd_thread thread;
+	thd_mutex mutex;
+	thd_condition wake, finished;
+	chunk_t *head, *tail; //requests
+	chunk_t *done; //finished loads waiting for world_update
+	bool quit;
+
+	//main thread only
+	bool open;
+	int pending; //loads requested but not yet installed
+	bool scanned;
+	ivec3 center;
+	int scanned_distance;
+} io;
+
+enum {
+	IO_LOAD,
+	IO_SAVE,
+};
+
+static void close_region(region_t *r){
+	if (r->file){
+		fclose(r->file);
+		free(r->used);
+		memset(r,0,sizeof(*r));
+	}
+}
+
+static region_t *get_region(int rx, int ry, int rz, bool create){
+	region_t *victim = io.regions;
+	for (int i = 0; i < REGION_CACHE; i++){
+		region_t *r = io.regions+i;
+		if (r->file && r->x == rx && r->y == ry && r->z == rz){
+			r->last_use = ++io.use_counter;
+			return r;
+		}
+		if (!r->file || (victim->file && r->last_use < victim->last_use)){
+			victim = r;
+		}
+	}
+	char path[512];
+	snprintf(path,sizeof(path),"%s/r.%d.%d.%d.mcr",io.region_dir,rx,ry,rz);
+	FILE *f = fopen(path,"r+b");
+	uint8_t header[SECTOR_SIZE];
+	if (f){
+		if (fread(header,SECTOR_SIZE,1,f) != 1){
+			fclose(f);
+			return 0;
+		}
+	} else {
+		if (!create){
+			return 0;
+		}
+		f = fopen(path,"w+b");
+		if (!f){
+			return 0;
+		}
+		memset(header,0,sizeof(header));
+		fwrite(header,SECTOR_SIZE,1,f);
+		fflush(f);
+	}
+	close_region(victim);
+	region_t *r = victim;
+	r->x = rx;
+	r->y = ry;
+	r->z = rz;
+	r->file = f;
+	r->last_use = ++io.use_counter;
+	fseek(f,0,SEEK_END);
+	r->sector_count = (int)((ftell(f) + SECTOR_SIZE-1) / SECTOR_SIZE);
+	r->used = calloc(r->sector_count,1);
+	ASSERT(r->used);
+	r->used[0] = 1;
+	for (int i = 0; i < REGION_CHUNKS; i++){
+		r->locations[i] = read_be32(header + i*4);
+		r->timestamps[i] = read_be32(header + REGION_CHUNKS*4 + i*4);
+		int offset = r->locations[i] >> 8;
+		int count = r->locations[i] & 0xff;
+		if (offset + count > r->sector_count){
+			r->locations[i] = 0; //truncated file, treat the chunk as missing
+			continue;
+		}
+		for (int s = 0; s < count; s++){
+			r->used[offset+s] = 1;
+		}
+	}
+	return r;
+}
+
+static int region_index(chunk_t *c){
+	int m = REGION_WIDTH-1;
+	return ((c->y & m)*REGION_WIDTH + (c->z & m))*REGION_WIDTH + (c->x & m);
+}
+
+static bool read_chunk(chunk_t *c){
+	if (!io.region_dir[0]){
+		return false;
+	}
+	region_t *r = get_region(c->x >> REGION_SHIFT,c->y >> REGION_SHIFT,c->z >> REGION_SHIFT,false);
+	if (!r){
+		return false;
+	}
+	uint32_t location = r->locations[region_index(c)];
+	if (!location){
+		return false;
+	}
+	uint8_t *buf = malloc((location & 0xff) * SECTOR_SIZE);
+	ASSERT(buf);
+	bool ok = false;
+	fseek(r->file,(long)(location >> 8) * SECTOR_SIZE,SEEK_SET);
+	if (fread(buf,(location & 0xff) * SECTOR_SIZE,1,r->file) == 1){
+		uint32_t length = read_be32(buf);
+		if (length >= 1 && length + 4 <= (location & 0xff) * SECTOR_SIZE && buf[4] == COMPRESSION_RLE){
+			int n = 0;
+			for (uint32_t i = 5; i+1 < length + 4 && n < CHUNK_VOLUME; i += 2){
+				int run = MIN(buf[i],CHUNK_VOLUME-n);
+				memset(c->blocks+n,buf[i+1],run);
+				n += run;
+			}
+			ok = n == CHUNK_VOLUME;
+		}
+	}
+	free(buf);
+	return ok;
+}
+
+static void write_chunk(chunk_t *c){
+	region_t *r = get_region(c->x >> REGION_SHIFT,c->y >> REGION_SHIFT,c->z >> REGION_SHIFT,true);
+	if (!r){
+		return;
+	}
+	static uint8_t buf[5 + 2*CHUNK_VOLUME + SECTOR_SIZE];
+	int n = 5;
+	for (int i = 0; i < CHUNK_VOLUME;){
+		int run = 1;
+		while (i+run < CHUNK_VOLUME && run < 255 && c->blocks[i+run] == c->blocks[i]){
+			run++;
+		}
+		buf[n++] = run;
+		buf[n++] = c->blocks[i];
+		i += run;
+	}
+	write_be32(buf,n-4);
+	buf[4] = COMPRESSION_RLE;
+	int count = (n + SECTOR_SIZE-1) / SECTOR_SIZE;
+	memset(buf+n,0,count*SECTOR_SIZE - n);
+
+	//reuse the old sectors if they fit, otherwise take the first free run or append
+	int index = region_index(c);
+	int offset = r->locations[index] >> 8;
+	int old_count = r->locations[index] & 0xff;
+	for (int s = 0; s < old_count; s++){
+		r->used[offset+s] = 0;
+	}
+	if (count > old_count){
+		offset = 0;
+		for (int s = 1, run = 0; s < r->sector_count; s++){
+			run = r->used[s] ? 0 : run+1;
+			if (run == count){
+				offset = s-count+1;
+				break;
+			}
+		}
+		if (!offset){
+			offset = r->sector_count;
+			r->sector_count += count;
+			r->used = realloc(r->used,r->sector_count);
+			ASSERT(r->used);
+			memset(r->used+offset,0,count);
+		}
+	}
+	for (int s = 0; s < count; s++){
+		r->used[offset+s] = 1;
+	}
+	fseek(r->file,(long)offset * SECTOR_SIZE,SEEK_SET);
+	fwrite(buf,count*SECTOR_SIZE,1,r->file);
+
+	r->locations[index] = (uint32_t)offset << 8 | count;
+	r->timestamps[index] = (uint32_t)time(0);
+	uint8_t entry[4];
+	write_be32(entry,r->locations[index]);
+	fseek(r->file,index*4,SEEK_SET);
+	fwrite(entry,4,1,r->file);
+	write_be32(entry,r->timestamps[index]);
+	fseek(r->file,REGION_CHUNKS*4 + index*4,SEEK_SET);
+	fwrite(entry,4,1,r->file);
+	fflush(r->file);
+}
+
+static void io_thread(void *data){
+	profile_set_thread_name("io");
+	thd_mutex_lock(&io.mutex);
+	for (;;){
+		while (!io.head && !io.quit){
+			thd_condition_wait(&io.wake,&io.mutex);
+		}
+		chunk_t *c = io.head;
+		if (!c){
+			break;
+		}
+		io.head = c->io_next;
+		if (!io.head){
+			io.tail = 0;
+		}
+		thd_mutex_unlock(&io.mutex);
+
+		uint64_t t = profile_begin();
+		if (c->io_op == IO_LOAD){
+			if (read_chunk(c)){
+				c->dirty = false;
+			} else {
+				generate_chunk(c);
+				c->dirty = io.region_dir[0] != 0;
+			}
+			rebuild_bricks(c);
+			rebuild_distances(c);
+			profile_end("chunk load",t);
+			thd_mutex_lock(&io.mutex);
+			c->io_next = io.done;
+			io.done = c;
+			thd_condition_signal(&io.finished);
+		} else {
+			write_chunk(c);
+			free(c);
+			profile_end("chunk save",t);
+			thd_mutex_lock(&io.mutex);
+		}
+	}
+	thd_mutex_unlock(&io.mutex);
+	for (int i = 0; i < REGION_CACHE; i++){
+		close_region(io.regions+i);
+	}
+}
+
+//callers hold io.mutex
+static void queue_io(chunk_t *c, int op){
+	c->io_op = op;
+	c->io_next = 0;
+	if (io.tail){
+		io.tail->io_next = c;
+	} else {
+		io.head = c;
+	}
+	io.tail = c;
+}
+
+void world_open(char *region_dir){
+	world_close();
+	memset(&io,0,sizeof(io));
+	world_changed_everywhere = true;
+	if (region_dir){
+		snprintf(io.region_dir,sizeof(io.region_dir),"%s",region_dir);
+#ifdef _WIN32
+		_mkdir(region_dir);
+#else
+		mkdir(region_dir,0777);
+#endif
+	}
+	thd_mutex_init(&io.mutex);
+	thd_condition_init(&io.wake);
+	thd_condition_init(&io.finished);
+	ASSERT(!thd_thread_detach(&io.thread,io_thread,0));
+	io.open = true;
+}
+
+//drops a chunk from the index. a resident one is handed to the io thread for saving or freed,
+//one still loading is freed by install_finished when it comes back. callers hold io.mutex.
+static void evict_chunk(chunk_t *c){
+	*chunk_slot(c->x,c->y,c->z) = 0;
+	if (!c->ready){
+		return;
+	}
+	log_chunk_change(c);
+	if (c->dirty && io.region_dir[0]){
+		queue_io(c,IO_SAVE);
+	} else {
+		free(c);
+	}
+}
+
+void world_close(void){
+	if (!io.open){
+		return;
+	}
+	thd_mutex_lock(&io.mutex);
+	for (int i = 0; i < COUNT(chunk_index); i++){
+		if (chunk_index[i]){
+			evict_chunk(chunk_index[i]);
+		}
+	}
+	io.quit = true;
+	thd_condition_signal(&io.wake);
+	thd_mutex_unlock(&io.mutex);
+	thd_thread_join(&io.thread);
+
+	//loads that finished after the last world_update were never installed
+	while (io.done){
+		chunk_t *c = io.done;
+		io.done = c->io_next;
+		free(c);
+	}
+	thd_condition_destroy(&io.finished);
+	thd_condition_destroy(&io.wake);
+	thd_mutex_destroy(&io.mutex);
+	io.open = false;
+}
+
+static void install_finished(void){
+	thd_mutex_lock(&io.mutex);
+	chunk_t *c = io.done;
+	io.done = 0;
+	thd_mutex_unlock(&io.mutex);
+	while (c){
+		chunk_t *next = c->io_next;
+		io.pending--;
+		if (lookup_chunk(c->x,c->y,c->z) == c){
+			c->ready = true;
+			log_chunk_change(c);
+		} else {
+			free(c); //evicted while loading
+		}
+		c = next;
+	}
+}
+
+static int chunk_distance(chunk_t *c, ivec3 center){
+	return MAX(abs(c->x - center[0]),MAX(abs(c->y - center[1]),abs(c->z - center[2])));
+}
+
+void world_update(vec3 center){
+	ASSERT(io.open);
+	install_finished();
+	view_distance = CLAMP(view_distance,0,MAX_VIEW_DISTANCE);
+
+	ivec3 cc;
+	for (int i = 0; i < 3; i++){
+		cc[i] = (int)floorf(center[i]) >> CHUNK_SHIFT;
+	}
+	if (io.scanned && !memcmp(cc,io.center,sizeof(cc)) && io.scanned_distance == view_distance){
+		return;
+	}
+	io.scanned = true;
+	memcpy(io.center,cc,sizeof(cc));
+	io.scanned_distance = view_distance;
+
+	thd_mutex_lock(&io.mutex);
+	//one chunk of slack so walking back and forth over a border doesn't thrash
+	for (int i = 0; i < COUNT(chunk_index); i++){
+		if (chunk_index[i] && chunk_distance(chunk_index[i],cc) > view_distance+1){
+			evict_chunk(chunk_index[i]);
+		}
+	}
+	//nearest shells first
+	for (int d = 0; d <= view_distance; d++){
+		for (int y = cc[1]-d; y <= cc[1]+d; y++){
+			for (int z = cc[2]-d; z <= cc[2]+d; z++){
+				for (int x = cc[0]-d; x <= cc[0]+d; x++){
+					if (MAX(abs(x-cc[0]),MAX(abs(y-cc[1]),abs(z-cc[2]))) != d || lookup_chunk(x,y,z)){
+						continue;
+					}
+					chunk_t **slot = chunk_slot(x,y,z);
+					ASSERT(!*slot);
+					chunk_t *c = calloc(1,sizeof(*c));
+					ASSERT(c);
+					c->x = x;
+					c->y = y;
+					c->z = z;
+					*slot = c;
+					queue_io(c,IO_LOAD);
+					io.pending++;
+				}
+			}
+		}
+	}
+	thd_condition_signal(&io.wake);
+	thd_mutex_unlock(&io.mutex);
+}
+
+void world_load_around(vec3 center){
+	world_update(center);
+	while (io.pending){
+		thd_mutex_lock(&io.mutex);
+		while (!io.done){
+			thd_condition_wait(&io.finished,&io.mutex);
+		}
+		thd_mutex_unlock(&io.mutex);
+		install_finished();
+	}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "tiny3d.h"
+
+typedef uint8_t block_t;
+
+//block types, 0 is air. how they look is up to the renderer's materials.
+enum {
+	BLOCK_AIR,
+	BLOCK_STONE,
+	BLOCK_GRASS,
+	BLOCK_DIRT,
+	BLOCK_PLANKS,
+	BLOCK_BRICKS,
+	BLOCK_LOG,
+	BLOCK_COBBLESTONE,
+	BLOCK_SAND,
+	BLOCK_GOLD,
+};
+
+//the world is an unbounded grid of 16^3 chunks. only chunks within view_distance of the
+//streaming center are resident; the rest live in region files or are generated on demand.
+//cells in non-resident chunks read as air.
+#define CHUNK_SHIFT 4
+#define CHUNK_WIDTH (1 << CHUNK_SHIFT)
+#define CHUNK_VOLUME (CHUNK_WIDTH*CHUNK_WIDTH*CHUNK_WIDTH)
+
+//occupancy hierarchy kept in every chunk: one 64 bit cell mask per 4x4x4 brick,
+//and one bit per brick saying whether any of its cells are solid.
+//blocks must be written through set_block so both levels stay in sync.
+#define BRICK_SHIFT 2
+#define BRICK_WIDTH (1 << BRICK_SHIFT)
+#define CHUNK_BRICKS (CHUNK_WIDTH / BRICK_WIDTH) //per axis
+#define CHUNK_BRICK_COUNT (CHUNK_BRICKS*CHUNK_BRICKS*CHUNK_BRICKS)
+
+typedef struct chunk {
+	int x, y, z; //in chunks
+	block_t blocks[CHUNK_VOLUME];
+	uint64_t brick_cells[CHUNK_BRICK_COUNT];
+	uint64_t brick_mask;
+	uint8_t distance[CHUNK_VOLUME]; //see below
+	uint8_t light[3][CHUNK_VOLUME]; //block light per color channel, kept by light_volume.c
+	bool ready; //set by the main thread once the io thread has filled it in
+	bool dirty;
+	struct chunk *io_next;
+	int io_op;
+} chunk_t;
+
+_Static_assert(CHUNK_BRICK_COUNT <= 64,"brick_mask holds one bit per brick");
+
+//distance holds, for every cell, the chebyshev distance to the nearest solid cell of the same
+//chunk, CHUNK_WIDTH if there is none. so every cell of the chunk within distance-1 of a cell on
+//all axes is air. it only looks inside the chunk, so an edit only invalidates its own chunk.
+
+//resident chunks are paged into a window of INDEX_WIDTH^3 slots addressed by chunk
+//coordinates modulo INDEX_WIDTH. everything resident lies within view_distance+1 of the
+//streaming center, so two resident chunks never share a slot.
+#define INDEX_SHIFT 4
+#define INDEX_WIDTH (1 << INDEX_SHIFT)
+#define MAX_VIEW_DISTANCE ((INDEX_WIDTH-3)/2)
+
+extern chunk_t *chunk_index[INDEX_WIDTH*INDEX_WIDTH*INDEX_WIDTH];
+extern int view_distance; //in chunks, at most MAX_VIEW_DISTANCE
+
+static inline chunk_t **chunk_slot(int cx, int cy, int cz){
+	int m = INDEX_WIDTH-1;
+	return chunk_index + ((((cy & m) << INDEX_SHIFT) | (cz & m)) << INDEX_SHIFT) + (cx & m);
+}
+
+//0 unless the chunk is resident
+static inline chunk_t *get_chunk(int cx, int cy, int cz){
+	chunk_t *c = *chunk_slot(cx,cy,cz);
+	return c && c->x == cx && c->y == cy && c->z == cz && c->ready ? c : 0;
+}
+
+static inline int chunk_block_index(int x, int y, int z){
+	return (((y & (CHUNK_WIDTH-1)) << CHUNK_SHIFT | (z & (CHUNK_WIDTH-1))) << CHUNK_SHIFT) | (x & (CHUNK_WIDTH-1));
+}
+
+static inline int chunk_brick_index(int bx, int by, int bz){
+	return ((by & (CHUNK_BRICKS-1))*CHUNK_BRICKS + (bz & (CHUNK_BRICKS-1)))*CHUNK_BRICKS + (bx & (CHUNK_BRICKS-1));
+}
+
+static inline block_t *get_block(int x, int y, int z){
+	chunk_t *c = get_chunk(x >> CHUNK_SHIFT,y >> CHUNK_SHIFT,z >> CHUNK_SHIFT);
+	return c ? c->blocks + chunk_block_index(x,y,z) : 0;
+}
+
+void set_block(int x, int y, int z, block_t b);
+
+//bricks in non-resident chunks count as empty.
+static inline bool brick_is_empty(int bx, int by, int bz){
+	int shift = CHUNK_SHIFT - BRICK_SHIFT;
+	chunk_t *c = get_chunk(bx >> shift,by >> shift,bz >> shift);
+	return !c || !(c->brick_mask & (1ull << chunk_brick_index(bx,by,bz)));
+}
+
+//cell mask of the brick holding cell x,y,z, 0 in non-resident chunks.
+static inline uint64_t brick_cells_at(int x, int y, int z){
+	chunk_t *c = get_chunk(x >> CHUNK_SHIFT,y >> CHUNK_SHIFT,z >> CHUNK_SHIFT);
+	return c ? c->brick_cells[chunk_brick_index(x >> BRICK_SHIFT,y >> BRICK_SHIFT,z >> BRICK_SHIFT)] : 0;
+}
+
+//bit of cell x,y,z within its brick's cell mask.
+static inline uint64_t cell_bit(int x, int y, int z){
+	return 1ull << (((y & (BRICK_WIDTH-1)) << (2*BRICK_SHIFT)) | ((z & (BRICK_WIDTH-1)) << BRICK_SHIFT) | (x & (BRICK_WIDTH-1)));
+}
+
+//boxes of blocks that changed since the last world_clear_changes: edits, and chunks becoming
+//resident or being evicted. lets caches built on the world's contents invalidate locally.
+//the renderer clears it in cull_lights once every cache has read it.
+#define WORLD_CHANGE_LOG 64
+
+typedef struct {
+	ivec3 min, max; //inclusive
+} block_box_t;
+
+extern block_box_t world_changes[WORLD_CHANGE_LOG];
+extern int world_change_count;
+extern bool world_changed_everywhere; //set by world_open
+void world_clear_changes(void);
+
+//streaming. all of these run on the main thread, never while a frame is rendering or a tick
+//is running (see sim_try_lock_world).
+//region_dir 0 keeps the world purely generated and never writes anything.
+void world_open(char *region_dir);
+void world_close(void); //saves dirty chunks and stops the io thread
+void world_update(vec3 center); //requests missing chunks, evicts far ones, installs finished loads
+void world_load_around(vec3 center); //world_update, then blocks until everything in view is resident
@@ -0,0 +1,58 @@
+#pragma once
+
+//single producer, single consumer ring of interleaved stereo int16 frames. the frame loop writes
+//what update() mixed, the audio thread reads it out to the device, and neither ever waits on the other.
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#define AUDIO_RING_FRAMES 16384 //a power of two
+
+typedef struct {
+	int16_t samples[AUDIO_RING_FRAMES*2];
+	//frames ever written and ever read, on their own cache lines so the two threads don't share one
+	_Alignas(64) _Atomic uint32_t written;
+	_Alignas(64) _Atomic uint32_t read;
+} audio_ring_t;
+
+//frames waiting to be read. the other thread's index may be stale, so from the reader it's a
+//lower bound, and from the writer an upper bound: the free space it implies is a lower bound.
+static inline int audio_ring_count(audio_ring_t *r){
+	return (int)(atomic_load_explicit(&r->written,memory_order_acquire) - atomic_load_explicit(&r->read,memory_order_acquire));
+}
+
+//how many frames the writer should produce to bring the ring up to latency frames
+static inline int audio_ring_wanted(audio_ring_t *r, int latency){
+	int wanted = latency - audio_ring_count(r);
+	return wanted < 0 ? 0 : wanted > AUDIO_RING_FRAMES ? AUDIO_RING_FRAMES : wanted;
+}
+
+//writer side. returns the number of frames that fit, the rest are dropped.
+static inline int audio_ring_write(audio_ring_t *r, int16_t *samples, int frames){
+	uint32_t w = atomic_load_explicit(&r->written,memory_order_relaxed);
+	uint32_t space = AUDIO_RING_FRAMES - (w - atomic_load_explicit(&r->read,memory_order_acquire));
+	if ((uint32_t)frames > space){
+		frames = (int)space;
+	}
+	uint32_t start = w & (AUDIO_RING_FRAMES-1);
+	int first = frames < (int)(AUDIO_RING_FRAMES - start) ? frames : (int)(AUDIO_RING_FRAMES - start);
+	memcpy(r->samples + start*2,samples,first*2*sizeof(*samples));
+	memcpy(r->samples,samples + first*2,(frames-first)*2*sizeof(*samples));
+	atomic_store_explicit(&r->written,w + frames,memory_order_release);
+	return frames;
+}
+
+//reader side. returns the number of frames read.
+static inline int audio_ring_read(audio_ring_t *r, int16_t *samples, int frames){
+	uint32_t rd = atomic_load_explicit(&r->read,memory_order_relaxed);
+	uint32_t available = atomic_load_explicit(&r->written,memory_order_acquire) - rd;
+	if ((uint32_t)frames > available){
+		frames = (int)available;
+	}
+	uint32_t start = rd & (AUDIO_RING_FRAMES-1);
+	int first = frames < (int)(AUDIO_RING_FRAMES - start) ? frames : (int)(AUDIO_RING_FRAMES - start);
+	memcpy(samples,r->samples + start*2,first*2*sizeof(*samples));
+	memcpy(samples + first*2,r->samples,(frames-first)*2*sizeof(*samples));
+	atomic_store_explicit(&r->read,rd + frames,memory_order_release);
+	return frames;
+}
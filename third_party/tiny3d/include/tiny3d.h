@@ -14,6 +14,7 @@
 #include <debugbreak.h>
 #include <whereami.h>
 #include <tinymath.h>
+#include <tinymath_inline.h>
 
 #define TINY3D_SAMPLE_RATE 44100
 #define TINY3D_AUDIO_BUFSZ 8192
@@ -42,12 +43,19 @@ extern void update(double time, double deltaTime, int width, int height, int nAu
 #define KEY_MOUSE_LEFT 128
 #define KEY_MOUSE_RIGHT 129
 extern void keydown(int key);
+//start and end, in get_time() nanoseconds, of a blocking platform call like the buffer swap or audio write.
+//the audio write is timed on the platform's audio thread, not the one running update().
+extern void platform_timing(char *name, uint64_t start, uint64_t end);
 extern void keyup(int key);
 extern void mousemove(int x, int y);
 
 bool is_mouse_locked(void);
 void lock_mouse(bool locked);
 
+//entry point of a gl function past what the system headers declare, 0 if the driver lacks it.
+//only valid once the window is open.
+void *gl_get_proc_address(char *name);
+
 //utility functions:
 void error_box(char *msg);
 void fatal_error(char *format, ...);
@@ -58,10 +66,24 @@ FILE *fopen_relative(char *format, ...);
 unsigned char *load_file(int *size, char *format, ...);
 char *load_file_as_cstring(char *format, ...);
 uint32_t *load_image(bool flip_vertically, int *width, int *height, char *format, ...);
+
+//read-only view of a whole file, mapped instead of copied. empty files can't be mapped.
+typedef struct {
+	unsigned char *data;
+	size_t size;
+	void *handle; //the mapping object on windows
+} mapped_file_t;
+bool map_file(mapped_file_t *f, char *path);
+void unmap_file(mapped_file_t *f);
+
+//8 bit, non-interlaced png to malloced rgba pixels (r in the first byte), 0 if it can't.
+//load_image uses it on linux, where there's no system decoder.
+uint32_t *decode_png(unsigned char *data, size_t size, bool flip_vertically, int *width, int *height);
 int16_t *load_audio(int *nFrames, char *format, ...);
 wchar_t *get_keyboard_layout_name();
 void get_key_text(int scancode, wchar_t *buf, int bufcount);
 float get_dpi_scale();
+uint64_t get_time(void); //monotonic, nanoseconds
 
 //text:
 void get_font_name(char *path, char *out, int outCount);
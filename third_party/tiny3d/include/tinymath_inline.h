@@ -0,0 +1,210 @@
+#pragma once
+
+//header-only versions of the hot tinymath routines, so calls in tight loops inline and vectorize.
+//each one does the same float operations in the same order as its tinymath.c counterpart and
+//returns bit-identical results. including this maps the tinymath names onto them; define
+//TINYMATH_NO_REMAP first to keep the out-of-line functions and call the tm_ names directly.
+
+#include <tinymath.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define TINYMATH_SSE 1
+#include <xmmintrin.h>
+#endif
+
+//four floats in a register, or an array where there is no sse
+#if TINYMATH_SSE
+typedef __m128 tm_simd_t;
+static inline tm_simd_t tm_load4(const float *p){ return _mm_loadu_ps(p); }
+static inline void tm_store4(float *p, tm_simd_t v){ _mm_storeu_ps(p,v); }
+static inline tm_simd_t tm_load3(const float *p){ return _mm_setr_ps(p[0],p[1],p[2],0.0f); }
+//three scalar stores, so reading a component back right away forwards from the store
+static inline void tm_store3(float *p, tm_simd_t v){
+	_mm_store_ss(p,v);
+	_mm_store_ss(p+1,_mm_shuffle_ps(v,v,_MM_SHUFFLE(1,1,1,1)));
+	_mm_store_ss(p+2,_mm_movehl_ps(v,v));
+}
+static inline tm_simd_t tm_set(float x, float y, float z, float w){ return _mm_setr_ps(x,y,z,w); }
+static inline tm_simd_t tm_splat(float f){ return _mm_set1_ps(f); }
+static inline tm_simd_t tm_add(tm_simd_t a, tm_simd_t b){ return _mm_add_ps(a,b); }
+static inline tm_simd_t tm_sub(tm_simd_t a, tm_simd_t b){ return _mm_sub_ps(a,b); }
+static inline tm_simd_t tm_mul(tm_simd_t a, tm_simd_t b){ return _mm_mul_ps(a,b); }
+#else
+typedef struct { float f[4]; } tm_simd_t;
+static inline tm_simd_t tm_load4(const float *p){ tm_simd_t v; memcpy(v.f,p,sizeof(v.f)); return v; }
+static inline void tm_store4(float *p, tm_simd_t v){ memcpy(p,v.f,sizeof(v.f)); }
+static inline tm_simd_t tm_load3(const float *p){ tm_simd_t v = {{p[0],p[1],p[2],0.0f}}; return v; }
+static inline void tm_store3(float *p, tm_simd_t v){ memcpy(p,v.f,3*sizeof(float)); }
+static inline tm_simd_t tm_set(float x, float y, float z, float w){ tm_simd_t v = {{x,y,z,w}}; return v; }
+static inline tm_simd_t tm_splat(float f){ tm_simd_t v = {{f,f,f,f}}; return v; }
+static inline tm_simd_t tm_add(tm_simd_t a, tm_simd_t b){ for (int i = 0; i < 4; i++) a.f[i] += b.f[i]; return a; }
+static inline tm_simd_t tm_sub(tm_simd_t a, tm_simd_t b){ for (int i = 0; i < 4; i++) a.f[i] -= b.f[i]; return a; }
+static inline tm_simd_t tm_mul(tm_simd_t a, tm_simd_t b){ for (int i = 0; i < 4; i++) a.f[i] *= b.f[i]; return a; }
+#endif
+
+//a column major matrix held in registers
+typedef struct {
+	tm_simd_t c[4];
+} tm_mat4_t;
+
+static inline tm_mat4_t tm_mat4_load(mat4 m){
+	tm_mat4_t r = {{tm_load4(m[0]),tm_load4(m[1]),tm_load4(m[2]),tm_load4(m[3])}};
+	return r;
+}
+
+//c0*x + c1*y + c2*z + c3*w, summed left to right like the scalar loops
+static inline tm_simd_t tm_mat4_apply(tm_mat4_t *m, float x, float y, float z, float w){
+	tm_simd_t r = tm_mul(m->c[0],tm_splat(x));
+	r = tm_add(r,tm_mul(m->c[1],tm_splat(y)));
+	r = tm_add(r,tm_mul(m->c[2],tm_splat(z)));
+	return tm_add(r,tm_mul(m->c[3],tm_splat(w)));
+}
+
+static inline tm_simd_t tm_mat4_apply3(tm_mat4_t *m, float x, float y, float z){
+	tm_simd_t r = tm_mul(m->c[0],tm_splat(x));
+	r = tm_add(r,tm_mul(m->c[1],tm_splat(y)));
+	return tm_add(r,tm_mul(m->c[2],tm_splat(z)));
+}
+
+static inline void tm_vec3_copy(vec3 src, vec3 dst){ memmove(dst,src,sizeof(vec3)); }
+static inline void tm_vec3_add(vec3 a, vec3 b, vec3 dst){ for (int i = 0; i < 3; i++) dst[i] = a[i] + b[i]; }
+static inline void tm_vec3_sub(vec3 a, vec3 b, vec3 dst){ for (int i = 0; i < 3; i++) dst[i] = a[i] - b[i]; }
+static inline void tm_vec3_negate(vec3 v, vec3 dst){ for (int i = 0; i < 3; i++) dst[i] = -v[i]; }
+static inline void tm_vec3_scale(vec3 v, float s, vec3 dst){ for (int i = 0; i < 3; i++) dst[i] = v[i] * s; }
+static inline void tm_vec3_mul(vec3 a, vec3 b, vec3 dst){ for (int i = 0; i < 3; i++) dst[i] = a[i] * b[i]; }
+static inline void tm_vec3_div(vec3 a, vec3 b, vec3 dst){ for (int i = 0; i < 3; i++) dst[i] = a[i] / b[i]; }
+static inline float tm_vec3_dot(vec3 a, vec3 b){ return a[0]*b[0] + a[1]*b[1] + a[2]*b[2]; }
+static inline float tm_vec3_length(vec3 v){ return sqrtf(tm_vec3_dot(v,v)); }
+
+static inline void tm_vec3_cross(vec3 a, vec3 b, vec3 dst){
+	float x = a[1]*b[2] - a[2]*b[1];
+	float y = a[2]*b[0] - a[0]*b[2];
+	float z = a[0]*b[1] - a[1]*b[0];
+	dst[0] = x;
+	dst[1] = y;
+	dst[2] = z;
+}
+
+static inline float tm_vec3_distance(vec3 a, vec3 b){
+	vec3 d;
+	tm_vec3_sub(b,a,d);
+	return tm_vec3_length(d);
+}
+
+static inline void tm_vec3_normalize(vec3 v, vec3 dst){ tm_vec3_scale(v,1/tm_vec3_length(v),dst); }
+static inline void tm_vec3_set_length(vec3 v, float l, vec3 dst){ tm_vec3_scale(v,l/tm_vec3_length(v),dst); }
+static inline void tm_vec3_lerp(vec3 a, vec3 b, float t, vec3 dst){ for (int i = 0; i < 3; i++) dst[i] = a[i] + t*(b[i]-a[i]); }
+
+static inline void tm_vec4_copy(vec4 src, vec4 dst){ memmove(dst,src,sizeof(vec4)); }
+static inline void tm_vec4_add(vec4 a, vec4 b, vec4 dst){ tm_store4(dst,tm_add(tm_load4(a),tm_load4(b))); }
+static inline void tm_vec4_sub(vec4 a, vec4 b, vec4 dst){ tm_store4(dst,tm_sub(tm_load4(a),tm_load4(b))); }
+static inline void tm_vec4_scale(vec4 v, float s, vec4 dst){ tm_store4(dst,tm_mul(tm_load4(v),tm_splat(s))); }
+static inline void tm_vec4_mul(vec4 a, vec4 b, vec4 dst){ tm_store4(dst,tm_mul(tm_load4(a),tm_load4(b))); }
+static inline float tm_vec4_dot(vec4 a, vec4 b){ return a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3]; }
+static inline float tm_vec4_length(vec4 v){ return sqrtf(tm_vec4_dot(v,v)); }
+
+static inline void tm_mat4_mul(mat4 a, mat4 b, mat4 dst){
+	tm_mat4_t ma = tm_mat4_load(a);
+	tm_simd_t c[4];
+	for (int i = 0; i < 4; i++){
+		c[i] = tm_mat4_apply(&ma,b[i][0],b[i][1],b[i][2],b[i][3]);
+	}
+	for (int i = 0; i < 4; i++){
+		tm_store4(dst[i],c[i]);
+	}
+}
+
+static inline void tm_mat4_mul_vec4(mat4 m, vec4 v, vec4 dst){
+	tm_mat4_t mm = tm_mat4_load(m);
+	tm_store4(dst,tm_mat4_apply(&mm,v[0],v[1],v[2],v[3]));
+}
+
+static inline void tm_mat4_mul_vec3_pos(mat4 m, vec3 v, vec4 dst){
+	tm_mat4_t mm = tm_mat4_load(m);
+	tm_store4(dst,tm_mat4_apply(&mm,v[0],v[1],v[2],1.0f));
+}
+
+static inline void tm_mat4_mul_vec3_dir(mat4 m, vec3 v, vec3 dst){
+	tm_mat4_t mm = tm_mat4_load(m);
+	tm_store3(dst,tm_mat4_apply3(&mm,v[0],v[1],v[2]));
+}
+
+//the upper 3x3 of mat4_rotate, without building the rest
+static inline tm_mat4_t tm_rotation(vec3 axis, float r){
+	float c = cosf(r), s = sinf(r);
+	vec3 n;
+	tm_vec3_normalize(axis,n);
+	tm_simd_t a = tm_load3(n);
+	float v0 = n[0] * (1.0f - c), v1 = n[1] * (1.0f - c), v2 = n[2] * (1.0f - c);
+	float s0 = n[0] * s, s1 = n[1] * s, s2 = n[2] * s;
+	tm_mat4_t m = {{
+		tm_add(tm_mul(a,tm_splat(v0)),tm_set(c,s2,-s1,0.0f)),
+		tm_add(tm_mul(a,tm_splat(v1)),tm_set(-s2,c,s0,0.0f)),
+		tm_add(tm_mul(a,tm_splat(v2)),tm_set(s1,-s0,c,0.0f)),
+		tm_set(0.0f,0.0f,0.0f,1.0f),
+	}};
+	return m;
+}
+
+static inline void tm_vec3_rotate_deg(vec3 in, vec3 axis, float angle, vec3 out){
+	tm_mat4_t m = tm_rotation(axis,angle*(float)M_PI/180.0f);
+	tm_store3(out,tm_mat4_apply(&m,in[0],in[1],in[2],0.0f));
+}
+
+//batched, with no tinymath.c counterparts: the matrix is loaded once for all count vectors.
+//in and out may be the same array.
+static inline void tm_mat4_transform_points(mat4 m, int count, vec3 *in, vec3 *out){
+	tm_mat4_t mm = tm_mat4_load(m);
+	for (int i = 0; i < count; i++){
+		tm_store3(out[i],tm_mat4_apply(&mm,in[i][0],in[i][1],in[i][2],1.0f));
+	}
+}
+
+static inline void tm_mat4_transform_dirs(mat4 m, int count, vec3 *in, vec3 *out){
+	tm_mat4_t mm = tm_mat4_load(m);
+	for (int i = 0; i < count; i++){
+		tm_store3(out[i],tm_mat4_apply3(&mm,in[i][0],in[i][1],in[i][2]));
+	}
+}
+
+static inline void tm_vec3_rotate_deg_n(int count, vec3 *in, vec3 axis, float angle, vec3 *out){
+	tm_mat4_t m = tm_rotation(axis,angle*(float)M_PI/180.0f);
+	for (int i = 0; i < count; i++){
+		tm_store3(out[i],tm_mat4_apply(&m,in[i][0],in[i][1],in[i][2],0.0f));
+	}
+}
+
+#ifndef TINYMATH_NO_REMAP
+#define vec3_copy tm_vec3_copy
+#define vec3_add tm_vec3_add
+#define vec3_sub tm_vec3_sub
+#define vec3_negate tm_vec3_negate
+#define vec3_scale tm_vec3_scale
+#define vec3_mul tm_vec3_mul
+#define vec3_div tm_vec3_div
+#define vec3_dot tm_vec3_dot
+#define vec3_length tm_vec3_length
+#define vec3_cross tm_vec3_cross
+#define vec3_distance tm_vec3_distance
+#define vec3_normalize tm_vec3_normalize
+#define vec3_set_length tm_vec3_set_length
+#define vec3_lerp tm_vec3_lerp
+#define vec3_rotate_deg tm_vec3_rotate_deg
+#define vec3_rotate_deg_n tm_vec3_rotate_deg_n
+#define vec4_copy tm_vec4_copy
+#define vec4_add tm_vec4_add
+#define vec4_sub tm_vec4_sub
+#define vec4_scale tm_vec4_scale
+#define vec4_mul tm_vec4_mul
+#define vec4_dot tm_vec4_dot
+#define vec4_length tm_vec4_length
+#define mat4_mul tm_mat4_mul
+#define mat4_mul_vec4 tm_mat4_mul_vec4
+#define mat4_mul_vec3_pos tm_mat4_mul_vec3_pos
+#define mat4_mul_vec3_dir tm_mat4_mul_vec3_dir
+#define mat4_transform_points tm_mat4_transform_points
+#define mat4_transform_dirs tm_mat4_transform_dirs
+#endif
@@ -0,0 +1,72 @@
+#include <tiny3d.h>
+
+#if _WIN32
+
+bool map_file(mapped_file_t *f, char *path){
+	memset(f,0,sizeof(*f));
+	HANDLE file = CreateFileA(path,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,0);
+	if (file == INVALID_HANDLE_VALUE){
+		return false;
+	}
+	LARGE_INTEGER size;
+	HANDLE mapping = 0;
+	if (GetFileSizeEx(file,&size) && size.QuadPart > 0){
+		mapping = CreateFileMappingA(file,0,PAGE_READONLY,0,0,0);
+	}
+	CloseHandle(file); //the mapping keeps the file open
+	if (!mapping){
+		return false;
+	}
+	f->data = MapViewOfFile(mapping,FILE_MAP_READ,0,0,0);
+	if (!f->data){
+		CloseHandle(mapping);
+		return false;
+	}
+	f->size = (size_t)size.QuadPart;
+	f->handle = mapping;
+	return true;
+}
+
+void unmap_file(mapped_file_t *f){
+	if (f->data){
+		UnmapViewOfFile(f->data);
+		CloseHandle(f->handle);
+	}
+	memset(f,0,sizeof(*f));
+}
+
+#else
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+bool map_file(mapped_file_t *f, char *path){
+	memset(f,0,sizeof(*f));
+	int fd = open(path,O_RDONLY);
+	if (fd < 0){
+		return false;
+	}
+	struct stat st;
+	void *data = MAP_FAILED;
+	if (!fstat(fd,&st) && st.st_size > 0){
+		data = mmap(0,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+	}
+	close(fd); //the mapping keeps the file open
+	if (data == MAP_FAILED){
+		return false;
+	}
+	f->data = data;
+	f->size = (size_t)st.st_size;
+	return true;
+}
+
+void unmap_file(mapped_file_t *f){
+	if (f->data){
+		munmap(f->data,f->size);
+	}
+	memset(f,0,sizeof(*f));
+}
+
+#endif
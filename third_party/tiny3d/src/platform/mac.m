@@ -8,6 +8,7 @@
 
 #include <AudioToolbox/AudioQueue.h>
 #include <AudioToolbox/ExtendedAudioFile.h>
+#include <dlfcn.h>
 struct fenster_audio {
 	AudioQueueRef queue;
 	size_t pos;
@@ -280,6 +281,10 @@ void lock_mouse(bool locked){
 	}
 }
 
+void *gl_get_proc_address(char *name){
+	return dlsym(RTLD_DEFAULT,name);
+}
+
 @interface MyOpenGLView : NSOpenGLView
 @end
 @implementation MyOpenGLView
@@ -309,7 +314,9 @@ void lock_mouse(bool locked){
 	
 	t0 = t1;
 
+	uint64_t ts = get_time();
 	[[self openGLContext] flushBuffer];
+	platform_timing("swap", ts, get_time());
 }
 - (BOOL)acceptsFirstResponder {
 	return YES;
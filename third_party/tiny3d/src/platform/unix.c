@@ -339,11 +339,68 @@ uint64_t get_time(void){
 
 bool is_mouse_locked(void){}
 void lock_mouse(bool locked){}
-uint32_t *load_image(bool flip_vertically, int *width, int *height, char *format, ...){}
+void toggle_fullscreen(){}
+void *gl_get_proc_address(char *name){
+    return (void *)glXGetProcAddress((const GLubyte *)name);
+}
+uint32_t *load_image(bool flip_vertically, int *width, int *height, char *format, ...){
+    va_list args;
+    va_start(args,format);
+    assertPath = local_path_to_absolute_vararg(format,args);
+    va_end(args);
+
+    mapped_file_t f;
+    ASSERT_FILE(map_file(&f,assertPath));
+    uint32_t *pixels = decode_png(f.data,f.size,flip_vertically,width,height);
+    unmap_file(&f);
+    ASSERT_FILE(pixels);
+    return pixels;
+}
 int16_t *load_audio(int *nFrames, char *format, ...){}
 
 #include <pulse/error.h>
 #include <pulse/simple.h>
+#include <pthread.h>
+#include <audio_ring.h>
+
+//update() keeps the ring topped up to AUDIO_LATENCY frames and a thread of its own writes it out to pulse,
+//so a slow audio server blocks that thread instead of the frame loop.
+#define AUDIO_LATENCY 2048 //about 46 ms at TINY3D_SAMPLE_RATE, on top of pulse's own buffer
+#define AUDIO_CHUNK 512 //frames handed to pulse per write
+
+static audio_ring_t audioRing;
+//the ring itself needs no lock, this is only for sleeping until update() writes to it or the window closes
+static pthread_mutex_t audioMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t audioWake = PTHREAD_COND_INITIALIZER;
+static bool audioQuit;
+
+static void *audio_thread(void *data){
+    pa_simple *stream = data;
+    static int16_t chunk[AUDIO_CHUNK*2];
+    for (;;){
+        //nothing queued means the frame loop is behind, pulse plays out what it has meanwhile
+        pthread_mutex_lock(&audioMutex);
+        while (!audioQuit && !audio_ring_count(&audioRing)){
+            pthread_cond_wait(&audioWake, &audioMutex);
+        }
+        bool quit = audioQuit;
+        pthread_mutex_unlock(&audioMutex);
+        if (quit){
+            return NULL;
+        }
+        int n = audio_ring_read(&audioRing, chunk, AUDIO_CHUNK);
+        uint64_t ta = get_time();
+        pa_simple_write(stream, chunk, n*2*sizeof(*chunk), NULL);
+        platform_timing("audio write", ta, get_time());
+    }
+}
+
+static void audio_signal(bool quit){
+    pthread_mutex_lock(&audioMutex);
+    audioQuit |= quit;
+    pthread_cond_signal(&audioWake);
+    pthread_mutex_unlock(&audioMutex);
+}
 
 #if USE_GL
 void open_window(int width, int height){
@@ -396,10 +453,18 @@ void open_window(int scale){
         "Game",            // Description of our stream.
         &spec,                // Our sample format.
         NULL,               // Use default channel map
-        NULL,               // Use default buffering attributes.
+        &(pa_buffer_attr){   // Keep pulse's own buffer short, the ring holds the rest.
+            .maxlength = (uint32_t)-1,
+            .tlength = AUDIO_LATENCY*2*sizeof(*audioBuf),
+            .prebuf = (uint32_t)-1,
+            .minreq = (uint32_t)-1,
+            .fragsize = (uint32_t)-1,
+        },
         NULL               // Ignore error code.
     );
     ASSERT(stream);
+    pthread_t audioThread;
+    ASSERT(!pthread_create(&audioThread, NULL, audio_thread, stream));
     
     for(;;)
     {
@@ -411,7 +476,12 @@ void open_window(int scale){
             {
                 switch(XKeycodeToKeysym(display, event.xkey.keycode, 0))
                 {
-                    case XK_Escape: return;
+                    case XK_Escape:
+                        //the thread is done with the stream before it goes
+                        audio_signal(true);
+                        pthread_join(audioThread, NULL);
+                        pa_simple_free(stream);
+                        return;
                 }
             }
         }
@@ -432,8 +502,8 @@ void open_window(int scale){
         t1 = get_time();
 
         double dt = (double)(t1-t0) / 1000000000.0;
-        int nFrames = MIN(TINY3D_AUDIO_BUFSZ,(int)(dt * TINY3D_SAMPLE_RATE));
-        //printf("nFrames: %d\n",nFrames);
+        //whatever the audio thread used up since the last frame, so a long frame gets a longer buffer
+        int nFrames = MIN(TINY3D_AUDIO_BUFSZ,audio_ring_wanted(&audioRing, AUDIO_LATENCY));
         #if USE_GL
             update((double)(t1-tstart) / 1000000000.0, dt, width, height, nFrames, audioBuf);
         #else
@@ -471,12 +541,13 @@ void open_window(int scale){
             glEnd();
         #endif
 
-        if (nFrames){
-            pa_simple_write(stream, audioBuf, nFrames*2*sizeof(*audioBuf), NULL);
-        }
+        audio_ring_write(&audioRing, audioBuf, nFrames);
+        audio_signal(false);
         
         t0 = t1;
 
+        uint64_t ts = get_time();
         glXSwapBuffers(display, window);
+        platform_timing("swap", ts, get_time());
     }
 }
\ No newline at end of file
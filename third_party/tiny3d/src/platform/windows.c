@@ -55,6 +55,16 @@ void error_box(char *msg){
     MessageBoxA(0,msg,"Error",MB_ICONERROR);
 }
 
+uint64_t get_time(void){
+    static LARGE_INTEGER freq = {0};
+    if (!freq.QuadPart){
+        QueryPerformanceFrequency(&freq);
+    }
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return (uint64_t)(t.QuadPart / freq.QuadPart) * 1000000000 + (uint64_t)(t.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+}
+
 uint32_t *load_image(bool flip_vertically, int *width, int *height, char *format, ...){
     va_list args;
     va_start(args,format);
@@ -586,6 +596,15 @@ void lock_mouse(bool locked){
 	}
 }
 
+void *gl_get_proc_address(char *name){
+	//wgl only knows extension and post 1.1 functions, and some drivers return small values instead of null
+	void *p = (void *)wglGetProcAddress(name);
+	if ((uintptr_t)p <= 3 || p == (void *)-1){
+		p = (void *)GetProcAddress(GetModuleHandleA("opengl32.dll"),name);
+	}
+	return p;
+}
+
 void toggle_fullscreen(){
 
 }
@@ -716,7 +735,9 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam){
 
             HDC hdc = GetDC(hwnd);
             ASSERT(hdc);
+            uint64_t ts = get_time();
             SwapBuffers(hdc);
+            platform_timing("swap", ts, get_time());
             ReleaseDC(hwnd,hdc);
 
             return 0;
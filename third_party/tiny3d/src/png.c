@@ -0,0 +1,319 @@
+#include <tiny3d.h>
+
+//png decoding for platforms without a system image decoder. covers the images we ship:
+//8 bit gray, gray+alpha, rgb, rgba and palette, not interlaced. inflate follows the layout of puff.c.
+
+typedef struct {
+	unsigned char *in, *end;
+	uint32_t bits;
+	int count;
+	unsigned char *out;
+	size_t out_size, out_pos;
+	bool error;
+} inflate_t;
+
+typedef struct {
+	short count[16]; //codes of each length
+	short symbol[288]; //symbols ordered by code
+} huffman_t;
+
+static const short length_base[29] = {3,4,5,6,7,8,9,10,11,13,15,17,19,23,27,31,35,43,51,59,67,83,99,115,131,163,195,227,258};
+static const short length_extra[29] = {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0};
+static const short dist_base[30] = {1,2,3,4,5,7,9,13,17,25,33,49,65,97,129,193,257,385,513,769,1025,1537,2049,3073,4097,6145,8193,12289,16385,24577};
+static const short dist_extra[30] = {0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13};
+
+static int get_bits(inflate_t *z, int n){
+	while (z->count < n){
+		if (z->in == z->end){
+			z->error = true;
+			return 0;
+		}
+		z->bits |= (uint32_t)*z->in++ << z->count;
+		z->count += 8;
+	}
+	int v = (int)(z->bits & ((1u << n) - 1));
+	z->bits >>= n;
+	z->count -= n;
+	return v;
+}
+
+static void build_huffman(huffman_t *h, unsigned char *lengths, int n){
+	memset(h->count,0,sizeof(h->count));
+	for (int i = 0; i < n; i++){
+		h->count[lengths[i]]++;
+	}
+	short offsets[16] = {0};
+	for (int len = 1; len < 15; len++){
+		offsets[len+1] = offsets[len] + h->count[len];
+	}
+	for (int i = 0; i < n; i++){
+		if (lengths[i]){
+			h->symbol[offsets[lengths[i]]++] = (short)i;
+		}
+	}
+}
+
+//codes are read a bit at a time, most significant bit first
+static int decode_symbol(inflate_t *z, huffman_t *h){
+	int code = 0, first = 0, index = 0;
+	for (int len = 1; len < 16; len++){
+		code |= get_bits(z,1);
+		int count = h->count[len];
+		if (code - count < first){
+			return h->symbol[index + (code - first)];
+		}
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+	}
+	z->error = true;
+	return 0;
+}
+
+static void inflate_codes(inflate_t *z, huffman_t *lit, huffman_t *dist){
+	while (!z->error){
+		int sym = decode_symbol(z,lit);
+		if (sym < 256){
+			if (z->out_pos == z->out_size){
+				z->error = true;
+				return;
+			}
+			z->out[z->out_pos++] = (unsigned char)sym;
+		} else if (sym == 256){
+			return;
+		} else {
+			sym -= 257;
+			if (sym >= 29){
+				z->error = true;
+				return;
+			}
+			size_t len = length_base[sym] + get_bits(z,length_extra[sym]);
+			int ds = decode_symbol(z,dist);
+			if (ds >= 30){
+				z->error = true;
+				return;
+			}
+			size_t d = dist_base[ds] + get_bits(z,dist_extra[ds]);
+			if (d > z->out_pos || len > z->out_size - z->out_pos){
+				z->error = true;
+				return;
+			}
+			for (size_t i = 0; i < len; i++, z->out_pos++){
+				z->out[z->out_pos] = z->out[z->out_pos - d];
+			}
+		}
+	}
+}
+
+static void inflate_stored(inflate_t *z){
+	z->bits = 0;
+	z->count = 0;
+	if (z->end - z->in < 4){
+		z->error = true;
+		return;
+	}
+	size_t len = z->in[0] | z->in[1] << 8;
+	if ((z->in[2] | z->in[3] << 8) != (~len & 0xffff) || (size_t)(z->end - z->in - 4) < len || len > z->out_size - z->out_pos){
+		z->error = true;
+		return;
+	}
+	memcpy(z->out + z->out_pos,z->in + 4,len);
+	z->in += 4 + len;
+	z->out_pos += len;
+}
+
+static void inflate_fixed(inflate_t *z){
+	static huffman_t lit, dist;
+	static bool built;
+	if (!built){
+		unsigned char lengths[288];
+		for (int i = 0; i < 288; i++){
+			lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+		}
+		build_huffman(&lit,lengths,288);
+		memset(lengths,5,30);
+		build_huffman(&dist,lengths,30);
+		built = true; //racing builders write the same tables
+	}
+	inflate_codes(z,&lit,&dist);
+}
+
+static void inflate_dynamic(inflate_t *z){
+	static const unsigned char order[19] = {16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15};
+	int nlen = get_bits(z,5) + 257, ndist = get_bits(z,5) + 1, ncode = get_bits(z,4) + 4;
+	if (nlen > 286 || ndist > 30){
+		z->error = true;
+		return;
+	}
+	unsigned char lengths[320] = {0};
+	for (int i = 0; i < ncode; i++){
+		lengths[order[i]] = (unsigned char)get_bits(z,3);
+	}
+	huffman_t lencode, dist;
+	build_huffman(&lencode,lengths,19);
+	memset(lengths,0,sizeof(lengths));
+	for (int i = 0; i < nlen + ndist && !z->error;){
+		int sym = decode_symbol(z,&lencode);
+		if (sym < 16){
+			lengths[i++] = (unsigned char)sym;
+			continue;
+		}
+		int value = 0, repeat;
+		if (sym == 16){
+			if (!i){
+				z->error = true;
+				return;
+			}
+			value = lengths[i-1];
+			repeat = 3 + get_bits(z,2);
+		} else if (sym == 17){
+			repeat = 3 + get_bits(z,3);
+		} else {
+			repeat = 11 + get_bits(z,7);
+		}
+		if (i + repeat > nlen + ndist){
+			z->error = true;
+			return;
+		}
+		while (repeat--){
+			lengths[i++] = (unsigned char)value;
+		}
+	}
+	huffman_t lit;
+	build_huffman(&lit,lengths,nlen);
+	build_huffman(&dist,lengths+nlen,ndist);
+	inflate_codes(z,&lit,&dist);
+}
+
+//zlib stream into exactly out_size bytes
+static bool zlib_decompress(unsigned char *in, size_t in_size, unsigned char *out, size_t out_size){
+	if (in_size < 2 || (in[0] & 15) != 8 || (in[0] << 8 | in[1]) % 31 || (in[1] & 32)){
+		return false;
+	}
+	inflate_t z = {.in = in+2, .end = in+in_size, .out = out, .out_size = out_size};
+	int last;
+	do {
+		last = get_bits(&z,1);
+		switch (get_bits(&z,2)){
+			case 0: inflate_stored(&z); break;
+			case 1: inflate_fixed(&z); break;
+			case 2: inflate_dynamic(&z); break;
+			default: z.error = true; break;
+		}
+	} while (!last && !z.error);
+	return !z.error && z.out_pos == out_size;
+}
+
+static uint32_t read_be32(unsigned char *p){
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static int paeth(int a, int b, int c){
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+
+uint32_t *decode_png(unsigned char *data, size_t size, bool flip_vertically, int *width, int *height){
+	static const unsigned char signature[8] = {0x89,'P','N','G','\r','\n',0x1a,'\n'};
+	if (size < 8 || memcmp(data,signature,8)){
+		return 0;
+	}
+	int w = 0, h = 0, color_type = -1;
+	unsigned char palette[256][4];
+	memset(palette,255,sizeof(palette));
+	unsigned char *idat = 0;
+	size_t idat_size = 0;
+	bool ok = false;
+	for (unsigned char *p = data+8; p + 12 <= data+size;){
+		uint32_t len = read_be32(p);
+		unsigned char *type = p+4, *chunk = p+8;
+		if (len > (size_t)(data+size - chunk) - 4){
+			break;
+		}
+		if (!memcmp(type,"IHDR",4) && len >= 13){
+			w = (int)read_be32(chunk);
+			h = (int)read_be32(chunk+4);
+			color_type = chunk[9];
+			//8 bits per channel, deflate, standard filters, no interlacing
+			if (chunk[8] != 8 || chunk[10] || chunk[11] || chunk[12] || w <= 0 || h <= 0 || w > 16384 || h > 16384){
+				break;
+			}
+		} else if (!memcmp(type,"PLTE",4)){
+			for (uint32_t i = 0; i < len/3 && i < 256; i++){
+				memcpy(palette[i],chunk+i*3,3);
+			}
+		} else if (!memcmp(type,"tRNS",4) && color_type == 3){
+			for (uint32_t i = 0; i < len && i < 256; i++){
+				palette[i][3] = chunk[i];
+			}
+		} else if (!memcmp(type,"IDAT",4)){
+			unsigned char *grown = realloc(idat,idat_size+len);
+			if (!grown){
+				break;
+			}
+			idat = grown;
+			memcpy(idat+idat_size,chunk,len);
+			idat_size += len;
+		} else if (!memcmp(type,"IEND",4)){
+			ok = true;
+			break;
+		}
+		p = chunk + len + 4; //past the crc
+	}
+	static const int channel_counts[7] = {1,0,3,1,2,0,4};
+	int channels = color_type >= 0 && color_type < 7 ? channel_counts[color_type] : 0;
+	if (!ok || !channels || !idat){
+		free(idat);
+		return 0;
+	}
+
+	//each row is a filter type byte followed by the row's bytes
+	size_t stride = (size_t)w * channels;
+	unsigned char *raw = malloc((stride+1) * h);
+	uint32_t *pixels = malloc((size_t)w * h * sizeof(*pixels));
+	if (!raw || !pixels || !zlib_decompress(idat,idat_size,raw,(stride+1) * h)){
+		free(idat);
+		free(raw);
+		free(pixels);
+		return 0;
+	}
+	free(idat);
+	unsigned char *prior = 0;
+	for (int y = 0; y < h; y++){
+		unsigned char *row = raw + y*(stride+1) + 1;
+		int filter = row[-1];
+		for (size_t i = 0; i < stride; i++){
+			int a = i >= (size_t)channels ? row[i-channels] : 0;
+			int b = prior ? prior[i] : 0;
+			int c = prior && i >= (size_t)channels ? prior[i-channels] : 0;
+			switch (filter){
+				case 0: break;
+				case 1: row[i] += a; break;
+				case 2: row[i] += b; break;
+				case 3: row[i] += (a + b) / 2; break;
+				case 4: row[i] += paeth(a,b,c); break;
+				default:
+					free(raw);
+					free(pixels);
+					return 0;
+			}
+		}
+		unsigned char *dst = (unsigned char *)(pixels + (size_t)(flip_vertically ? h-1-y : y) * w);
+		for (int x = 0; x < w; x++, dst += 4){
+			unsigned char *s = row + x*channels;
+			switch (color_type){
+				case 0: dst[0] = dst[1] = dst[2] = s[0]; dst[3] = 255; break;
+				case 2: memcpy(dst,s,3); dst[3] = 255; break;
+				case 3: memcpy(dst,palette[s[0]],4); break;
+				case 4: dst[0] = dst[1] = dst[2] = s[0]; dst[3] = s[1]; break;
+				case 6: memcpy(dst,s,4); break;
+			}
+		}
+		prior = row;
+	}
+	free(raw);
+	*width = w;
+	*height = h;
+	return pixels;
+}
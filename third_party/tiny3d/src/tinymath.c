@@ -210,7 +210,7 @@ void vec4_scale(vec4 v, float s, vec4 dst){
 
 void vec4_mul(vec4 a, vec4 b, vec4 dst){
 	for (int i = 0; i < 4; i++){
-		dst[0] = a[i] * b[i];
+		dst[i] = a[i] * b[i];
 	}
 }
 
@@ -0,0 +1,695 @@
+//headless render benchmark: replays scripted camera/light scenarios, or an input log recorded
+//with -R, through tick() and the tile renderer and reports timings as json.
+#include "tiny3d.h"
+#include "world.h"
+#include "render.h"
+#include "raycast.h"
+#include "profile.h"
+#include "mixer.h"
+#include "audio_ring.h"
+#include "assets.h"
+#include "replay.h"
+#include "capture.h"
+
+#define FRAMES_PER_TICK 3
+
+enum {
+	FORWARD = 1,
+	BACKWARD = 2,
+	LEFT = 4,
+	RIGHT = 8,
+	JUMP = 16,
+	SHOOT = 32,
+	SWARM = 64, //drops SWARM_SIZE bare physics bodies around the room
+};
+
+#define SWARM_SIZE 500
+
+//head rotation is interpolated between keyframes, keys are held until the next keyframe.
+typedef struct {
+	int tick;
+	float pitch, yaw;
+	int input;
+} keyframe_t;
+
+typedef struct {
+	char *name;
+	vec3 start;
+	int keyframe_count;
+	keyframe_t *keyframes;
+	replay_t *replay; //instead of the keyframes
+} scenario_t;
+
+keyframe_t orbit[] = {
+	{0, -10, 0, SHOOT},
+	{5, -10, 90, SHOOT},
+	{10, -10, 180, SHOOT},
+	{15, -10, 270, SHOOT},
+	{20, -20, 360, 0},
+	{140, -20, 720, 0},
+};
+
+keyframe_t walk[] = {
+	{0, 0, 225, FORWARD},
+	{10, -15, 225, FORWARD | SHOOT},
+	{30, 0, 200, FORWARD | SHOOT},
+	{50, 10, 250, FORWARD | JUMP | SHOOT},
+	{70, -5, 225, FORWARD | SHOOT},
+	{90, 0, 45, BACKWARD},
+	{110, 0, 45, LEFT | SHOOT},
+	{130, 0, 45, 0},
+};
+
+keyframe_t ceiling[] = {
+	{0, 60, 0, SHOOT},
+	{10, 90, 0, 0},
+	{80, 90, 360, 0},
+};
+
+keyframe_t crowd[] = {
+	{0, -30, 0, SHOOT},
+	{1, -30, 22, SHOOT},
+	{2, -30, 45, SHOOT},
+	{3, -30, 67, SHOOT},
+	{4, -30, 90, SHOOT},
+	{5, -30, 112, SHOOT},
+	{6, -30, 135, SHOOT},
+	{7, -30, 157, SHOOT},
+	{8, -30, 180, SHOOT},
+	{9, -30, 202, SHOOT},
+	{10, -30, 225, SHOOT},
+	{11, -30, 247, SHOOT},
+	{12, -30, 270, SHOOT},
+	{13, -30, 292, SHOOT},
+	{14, -30, 315, SHOOT},
+	{15, -30, 337, SHOOT},
+	{16, -30, 360, 0},
+	{100, -45, 720, 0},
+};
+
+keyframe_t swarm[] = {
+	{0, -20, 0, SWARM},
+	{1, -20, 10, SWARM},
+	{2, -20, 20, SWARM},
+	{3, -20, 30, SWARM},
+	{4, -20, 40, SWARM},
+	{5, -20, 50, SWARM},
+	{6, -20, 60, SWARM},
+	{7, -20, 70, SWARM},
+	{8, -20, 80, 0},
+	{100, -20, 360, 0},
+};
+
+#define SCENARIO(name,x,y,z) {#name, {x,y,z}, COUNT(name), name}
+scenario_t scenarios[] = {
+	SCENARIO(orbit,16,2,16),
+	SCENARIO(walk,24,2,24),
+	SCENARIO(ceiling,16,2,16),
+	SCENARIO(crowd,16,2,16),
+	SCENARIO(swarm,16,2,16),
+};
+
+typedef struct {
+	double mean, p50, p90, p99, max;
+} summary_t;
+
+int compare_doubles(const void *a, const void *b){
+	return COMPARE(*(double *)a,*(double *)b);
+}
+
+void summarize(double *samples, int count, summary_t *s){
+	memset(s,0,sizeof(*s));
+	if (!count){
+		return;
+	}
+	qsort(samples,count,sizeof(*samples),compare_doubles);
+	for (int i = 0; i < count; i++){
+		s->mean += samples[i];
+	}
+	s->mean /= count;
+	s->p50 = samples[(count-1)*50/100];
+	s->p90 = samples[(count-1)*90/100];
+	s->p99 = samples[(count-1)*99/100];
+	s->max = samples[count-1];
+}
+
+//-a on: the frames also mix audio into a ring that a null sink drains in real time, the way the
+//platform's audio thread would, and the sink counts the periods it found the ring short.
+#define AUDIO_LATENCY 2048
+#define SINK_PERIOD_MS 5
+
+bool audio;
+sound_t shoot_sound, hum_sound;
+audio_ring_t audio_ring;
+_Atomic bool sink_running;
+_Atomic uint64_t sink_underruns, sink_missing_frames;
+
+static void sleep_ms(int ms){
+#if _WIN32
+	Sleep(ms);
+#else
+	nanosleep(&(struct timespec){.tv_sec = ms / 1000, .tv_nsec = ms % 1000 * 1000000},0);
+#endif
+}
+
+static void null_sink(void *data){
+	uint64_t start = get_time(), played = 0;
+	static int16_t chunk[1024*2];
+	while (atomic_load(&sink_running)){
+		sleep_ms(SINK_PERIOD_MS);
+		uint64_t due = (get_time() - start) * TINY3D_SAMPLE_RATE / 1000000000;
+		while (played < due){
+			int n = audio_ring_read(&audio_ring,chunk,(int)MIN(due-played,COUNT(chunk)/2));
+			if (!n){
+				atomic_fetch_add(&sink_underruns,1);
+				atomic_fetch_add(&sink_missing_frames,due-played);
+				played = due;
+				break;
+			}
+			played += n;
+		}
+	}
+}
+
+static void mix_frame(void){
+	static int16_t samples[TINY3D_AUDIO_BUFSZ*2];
+	vec3 eye, ray, right;
+	get_player_eye_ray(eye,ray);
+	vec3_cross(ray,(vec3){0,1,0},right);
+	vec3_normalize(right,right);
+	mixer_set_listener(eye,right);
+	int frames = MIN(TINY3D_AUDIO_BUFSZ,audio_ring_wanted(&audio_ring,AUDIO_LATENCY));
+	uint64_t t = profile_begin();
+	mixer_mix(samples,frames);
+	profile_end("mix",t);
+	audio_ring_write(&audio_ring,samples,frames);
+}
+
+void reset_sim(scenario_t *s){
+	light_count = 0;
+	clear_entities();
+	memset(&keys,0,sizeof(keys));
+	memset(player.velocity,0,sizeof(player.velocity));
+	player.on_ground = false;
+	if (s->replay){
+		replay_header_t *h = &s->replay->header;
+		player.head_rotation[0] = h->start_pitch;
+		player.head_rotation[1] = h->start_yaw;
+		entity_set_position(&player,h->start[0],h->start[1],h->start[2]);
+	} else {
+		player.head_rotation[0] = s->keyframes[0].pitch;
+		player.head_rotation[1] = s->keyframes[0].yaw;
+		entity_set_position(&player,s->start[0],s->start[1],s->start[2]);
+	}
+	world_open(0);
+	world_load_around(player.current_position);
+	interpolant = 0.0;
+	srand(1);
+	sim_seed = 1;
+}
+
+void apply_keyframe(scenario_t *s, int tick){
+	if (s->replay){
+		replay_apply(s->replay->ticks+tick);
+		return;
+	}
+	int k = 0;
+	while (k+1 < s->keyframe_count && s->keyframes[k+1].tick <= tick){
+		k++;
+	}
+	keyframe_t *a = s->keyframes+k;
+	keyframe_t *b = k+1 < s->keyframe_count ? a+1 : a;
+	float t = b->tick > a->tick ? (float)(tick - a->tick) / (b->tick - a->tick) : 0.0f;
+	player.head_rotation[0] = LERP(a->pitch,b->pitch,t);
+	player.head_rotation[1] = fmodf(LERP(a->yaw,b->yaw,t),360.0f);
+	keys.forward = a->input & FORWARD;
+	keys.backward = a->input & BACKWARD;
+	keys.left = a->input & LEFT;
+	keys.right = a->input & RIGHT;
+	keys.jump = a->input & JUMP;
+	keys.just_attacked = a->tick == tick && (a->input & SHOOT);
+	//not input, a recording of this doesn't replay the same
+	if (a->tick == tick && (a->input & SWARM)){
+		for (int i = 0; i < SWARM_SIZE; i++){
+			vec3 p = {1.0f + rand()%3000 / 100.0f,1.0f + rand()%800 / 100.0f,1.0f + rand()%3000 / 100.0f};
+			vec3 v = {(rand()%100 - 50) / 100.0f,(rand()%100) / 200.0f,(rand()%100 - 50) / 100.0f};
+			add_entity(0.25f,0.25f,p,v);
+		}
+	}
+}
+
+//-H: every frame's screen is hashed, outside the timings, and checked against the hashes of an
+//earlier run, so a change can be shown to leave the output alone on the same workload
+uint64_t *frame_hashes;
+int frame_hash_count;
+bool hash_frames;
+
+//-C: every frame is handed to the capture writer, timed on its own
+bool capturing;
+
+static uint64_t hash_bytes(uint64_t h, void *data, size_t size){
+	unsigned char *p = data;
+	for (size_t i = 0; i < size; i++){
+		h = (h ^ p[i]) * 1099511628211ull;
+	}
+	return h;
+}
+
+//whichever buffer the frame was finished into, along with its output mode and size so a
+//change of either never matches
+static uint64_t hash_screen(void){
+	int header[3] = {screen_output,screen_width,screen_height};
+	uint64_t h = hash_bytes(14695981039346656037ull,header,sizeof(header));
+	if (screen_output == RENDER_OUTPUT_CGA_PACKED){
+		return hash_bytes(h,screen_packed,(size_t)((screen_width+1)/2)*screen_height);
+	}
+	return hash_bytes(h,screen,(size_t)screen_width*screen_height*sizeof(*screen));
+}
+
+void run_scenario(scenario_t *s, float aspect, FILE *out, bool last, char *record_path){
+	int ticks = s->replay ? s->replay->tick_count : s->keyframes[s->keyframe_count-1].tick;
+	int frames = ticks * FRAMES_PER_TICK;
+	double *frame_ms = malloc(frames*sizeof(*frame_ms));
+	double *tick_ms = malloc(ticks*sizeof(*tick_ms));
+	ASSERT(frame_ms && tick_ms);
+	int first_hash = frame_hash_count;
+	if (hash_frames){
+		frame_hashes = realloc(frame_hashes,(frame_hash_count+frames)*sizeof(*frame_hashes));
+		ASSERT(frame_hashes);
+	}
+
+	reset_sim(s);
+	if (record_path && !replay_record_begin(record_path)){
+		fprintf(stderr,"couldn't record input to %s\n",record_path);
+	}
+	render_reset_stats();
+	pool_reset_stats();
+
+	uint64_t render_ns = 0;
+	uint64_t pixels = 0;
+	uint64_t capture_ns = 0, capture_max_ns = 0;
+	capture_stats_t cs0;
+	capture_get_stats(&cs0);
+	thd_thread sink;
+	uint64_t mix_ns = 0;
+	int hum = -1;
+	if (audio){
+		audio_ring.read = audio_ring.written;
+		sink_underruns = sink_missing_frames = 0;
+		hum = mixer_play_at(&hum_sound,player.current_position,8.0f,0.2f);
+		mix_frame(); //the first frame is queued before the sink starts, as with a real device
+		sink_running = true;
+		ASSERT(!thd_thread_detach(&sink,null_sink,0));
+	}
+	for (int tick_index = 0; tick_index < ticks; tick_index++){
+		uint64_t t0 = get_time();
+		apply_keyframe(s,tick_index);
+		replay_record_tick();
+		int count = light_count;
+		uint64_t t = profile_begin();
+		tick();
+		profile_end("tick",t);
+		if (audio && light_count > count){
+			mixer_play_at(&shoot_sound,entities.current_position[lights[count].entity],16.0f,0.5f);
+		}
+		uint64_t t1 = get_time();
+		tick_ms[tick_index] = (t1-t0) / 1e6;
+		for (int f = 0; f < FRAMES_PER_TICK; f++){
+			interpolant = (double)f / FRAMES_PER_TICK;
+			uint64_t frame = profile_begin();
+			uint64_t t2 = get_time();
+			if (audio){
+				mix_frame();
+				mix_ns += get_time() - t2;
+			}
+			render_frame(aspect);
+			uint64_t t3 = get_time();
+			profile_end("frame",frame);
+			pixels += screen_width*screen_height;
+			render_ns += t3-t2;
+			frame_ms[tick_index*FRAMES_PER_TICK+f] = (t3-t2) / 1e6 + (f == 0 ? tick_ms[tick_index] : 0.0);
+			if (hash_frames){
+				frame_hashes[frame_hash_count++] = hash_screen();
+			}
+			if (capturing){
+				uint64_t t4 = get_time();
+				capture_frame();
+				uint64_t ns = get_time() - t4;
+				capture_ns += ns;
+				capture_max_ns = MAX(capture_max_ns,ns);
+			}
+		}
+	}
+	replay_record_end();
+
+	if (audio){
+		sink_running = false;
+		thd_thread_join(&sink);
+		mixer_stop(hum);
+	}
+
+	uint64_t primary_rays = 0, shadow_rays = 0, cached_shadows = 0, reprojected_pixels = 0;
+	for (int i = 0; i < pool_get_thread_count(); i++){
+		primary_rays += render_stats[i].primary_rays;
+		shadow_rays += render_stats[i].shadow_rays;
+		cached_shadows += render_stats[i].cached_shadows;
+		reprojected_pixels += render_stats[i].reprojected_pixels;
+	}
+	pool_stats_t ps;
+	pool_get_stats(&ps);
+	summary_t fs, ts;
+	summarize(frame_ms,frames,&fs);
+	summarize(tick_ms,ticks,&ts);
+	double render_sec = render_ns / 1e9;
+
+	fprintf(out,"\t\t{\n");
+	fprintf(out,"\t\t\t\"name\": \"%s\",\n",s->name);
+	fprintf(out,"\t\t\t\"ticks\": %d,\n",ticks);
+	fprintf(out,"\t\t\t\"frames\": %d,\n",frames);
+	fprintf(out,"\t\t\t\"lights\": %d,\n",light_count);
+	fprintf(out,"\t\t\t\"mean_pixels\": %.0f,\n",(double)pixels / frames);
+	fprintf(out,"\t\t\t\"final_resolution\": [%d, %d],\n",screen_width,screen_height);
+	fprintf(out,"\t\t\t\"entities\": %d,\n",entities.count - entities.free_count);
+	fprintf(out,"\t\t\t\"frame_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",fs.mean,fs.p50,fs.p90,fs.p99,fs.max);
+	fprintf(out,"\t\t\t\"tick_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",ts.mean,ts.p50,ts.p90,ts.p99,ts.max);
+	fprintf(out,"\t\t\t\"primary_rays\": %llu,\n",(unsigned long long)primary_rays);
+	fprintf(out,"\t\t\t\"shadow_rays\": %llu,\n",(unsigned long long)shadow_rays);
+	fprintf(out,"\t\t\t\"cached_shadows\": %llu,\n",(unsigned long long)cached_shadows);
+	fprintf(out,"\t\t\t\"reprojected_pixels\": %llu,\n",(unsigned long long)reprojected_pixels);
+	if (hash_frames){
+		uint64_t h = 0;
+		for (int i = first_hash; i < frame_hash_count; i++){
+			h = h*31 + frame_hashes[i];
+		}
+		fprintf(out,"\t\t\t\"output_hash\": \"%016llx\",\n",(unsigned long long)h);
+	}
+	if (capturing){
+		capture_stats_t cs;
+		capture_get_stats(&cs);
+		fprintf(out,"\t\t\t\"capture\": {\"mean_ms\": %.4f, \"max_ms\": %.4f, \"dropped\": %llu},\n",
+			capture_ns / 1e6 / frames,capture_max_ns / 1e6,(unsigned long long)(cs.dropped - cs0.dropped));
+	}
+	if (audio){
+		fprintf(out,"\t\t\t\"audio\": {\"mix_ms\": %.4f, \"underruns\": %llu, \"missing_ms\": %.1f},\n",
+			mix_ns / 1e6 / frames,(unsigned long long)sink_underruns,sink_missing_frames * 1000.0 / TINY3D_SAMPLE_RATE);
+	}
+	fprintf(out,"\t\t\t\"primary_rays_per_sec\": %.0f,\n",primary_rays / render_sec);
+	fprintf(out,"\t\t\t\"shadow_rays_per_sec\": %.0f,\n",shadow_rays / render_sec);
+	fprintf(out,"\t\t\t\"thread_utilization\": [");
+	for (int i = 0; i < pool_get_thread_count(); i++){
+		fprintf(out,"%s%.4f",i ? ", " : "",ps.wall_ns ? (double)ps.busy_ns[i] / ps.wall_ns : 0.0);
+	}
+	fprintf(out,"]\n");
+	fprintf(out,"\t\t}%s\n",last ? "" : ",");
+
+	fprintf(stderr,"%-10s %6.3f ms/frame (p99 %6.3f)  %6.2f Mprimary/s  %6.2f Mshadow/s\n",
+		s->name,fs.mean,fs.p99,primary_rays / render_sec / 1e6,shadow_rays / render_sec / 1e6);
+
+	free(frame_ms);
+	free(tick_ms);
+}
+
+#define HASHES_MAGIC "t3dhash1"
+
+//writes the hashes if the file doesn't exist yet, otherwise compares them with it.
+//returns the first frame that differs, -1 when they all match and -2 for a new file.
+int check_hashes(char *path){
+	FILE *f = fopen(path,"rb");
+	if (!f){
+		f = fopen(path,"wb");
+		bool ok = f && fwrite(HASHES_MAGIC,8,1,f) == 1
+			&& fwrite(frame_hashes,sizeof(*frame_hashes),frame_hash_count,f) == (size_t)frame_hash_count;
+		if (!f || fclose(f) || !ok){
+			fatal_error("couldn't write %s",path);
+		}
+		return -2;
+	}
+	char magic[8];
+	if (fread(magic,sizeof(magic),1,f) != 1 || memcmp(magic,HASHES_MAGIC,sizeof(magic))){
+		fatal_error("%s isn't a hash file",path);
+	}
+	int mismatch = -1;
+	for (int i = 0; mismatch < 0 && i <= frame_hash_count; i++){
+		uint64_t h;
+		bool read = fread(&h,sizeof(h),1,f) == 1;
+		//a different frame count is a mismatch at the first frame only one of them has
+		if (i == frame_hash_count ? read : !read || h != frame_hashes[i]){
+			mismatch = i;
+		}
+	}
+	fclose(f);
+	return mismatch;
+}
+
+void usage(char *argv0){
+	fprintf(stderr,"usage: %s [-s scenario] [-t threads] [-p packet_mode] [-e engine] [-c on|off] [-r on|off] [-q output] [-d on|off] [-a on|off] [-x on|off] [-b on|off] [-l lighting] [-C capture] [-W WIDTHxHEIGHT] [-F target_fill_ms] [-L input.log] [-R input.log] [-H hashes] [-P trace.json] [-o out.json]\nscenarios:",argv0);
+	for (int i = 0; i < COUNT(scenarios); i++){
+		fprintf(stderr," %s",scenarios[i].name);
+	}
+	fprintf(stderr,"\npacket modes:");
+	for (int i = 0; i < RAY_PACKET_MODE_COUNT; i++){
+		fprintf(stderr," %s",ray_packet_mode_names[i]);
+	}
+	fprintf(stderr,"\nengines:");
+	for (int i = 0; i < RAYCAST_ENGINE_COUNT; i++){
+		fprintf(stderr," %s",raycast_engine_names[i]);
+	}
+	fprintf(stderr,"\nlighting:");
+	for (int i = 0; i < RENDER_LIGHTING_COUNT; i++){
+		fprintf(stderr," %s",render_lighting_names[i]);
+	}
+	fprintf(stderr,"\noutputs:");
+	for (int i = 0; i < RENDER_OUTPUT_COUNT; i++){
+		fprintf(stderr," %s",render_output_names[i]);
+	}
+	fprintf(stderr,"\n");
+	exit(1);
+}
+
+int main(int argc, char **argv){
+	char *only = 0;
+	char *out_path = 0;
+	bool textures = true;
+	char *trace_path = 0;
+	char *replay_path = 0, *record_path = 0, *hash_path = 0, *capture_path = 0;
+	int threads = 0;
+	int width = DEFAULT_SCREEN_WIDTH, height = DEFAULT_SCREEN_HEIGHT;
+	for (int i = 1; i < argc; i++){
+		if (!strcmp(argv[i],"-s") && i+1 < argc){
+			only = argv[++i];
+		} else if (!strcmp(argv[i],"-t") && i+1 < argc){
+			threads = atoi(argv[++i]);
+		} else if (!strcmp(argv[i],"-p") && i+1 < argc){
+			i++;
+			int mode = 0;
+			while (mode < RAY_PACKET_MODE_COUNT && strcmp(argv[i],ray_packet_mode_names[mode])){
+				mode++;
+			}
+			if (mode == RAY_PACKET_MODE_COUNT){
+				usage(argv[0]);
+			}
+			raycast_set_packet_mode(mode);
+		} else if (!strcmp(argv[i],"-e") && i+1 < argc){
+			i++;
+			int engine = 0;
+			while (engine < RAYCAST_ENGINE_COUNT && strcmp(argv[i],raycast_engine_names[engine])){
+				engine++;
+			}
+			if (engine == RAYCAST_ENGINE_COUNT){
+				usage(argv[0]);
+			}
+			raycast_engine = engine;
+		} else if (!strcmp(argv[i],"-c") && i+1 < argc){
+			i++;
+			if (strcmp(argv[i],"on") && strcmp(argv[i],"off")){
+				usage(argv[0]);
+			}
+			render_light_cache = !strcmp(argv[i],"on");
+		} else if (!strcmp(argv[i],"-r") && i+1 < argc){
+			i++;
+			if (strcmp(argv[i],"on") && strcmp(argv[i],"off")){
+				usage(argv[0]);
+			}
+			render_temporal = !strcmp(argv[i],"on");
+		} else if (!strcmp(argv[i],"-q") && i+1 < argc){
+			i++;
+			int output = 0;
+			while (output < RENDER_OUTPUT_COUNT && strcmp(argv[i],render_output_names[output])){
+				output++;
+			}
+			if (output == RENDER_OUTPUT_COUNT){
+				usage(argv[0]);
+			}
+			render_output = output;
+		} else if (!strcmp(argv[i],"-d") && i+1 < argc){
+			i++;
+			if (strcmp(argv[i],"on") && strcmp(argv[i],"off")){
+				usage(argv[0]);
+			}
+			render_dither = !strcmp(argv[i],"on");
+		} else if (!strcmp(argv[i],"-a") && i+1 < argc){
+			i++;
+			if (strcmp(argv[i],"on") && strcmp(argv[i],"off")){
+				usage(argv[0]);
+			}
+			audio = !strcmp(argv[i],"on");
+		} else if (!strcmp(argv[i],"-x") && i+1 < argc){
+			i++;
+			if (strcmp(argv[i],"on") && strcmp(argv[i],"off")){
+				usage(argv[0]);
+			}
+			textures = !strcmp(argv[i],"on");
+		} else if (!strcmp(argv[i],"-b") && i+1 < argc){
+			i++;
+			if (strcmp(argv[i],"on") && strcmp(argv[i],"off")){
+				usage(argv[0]);
+			}
+			render_beams = !strcmp(argv[i],"on");
+		} else if (!strcmp(argv[i],"-l") && i+1 < argc){
+			i++;
+			int lighting = 0;
+			while (lighting < RENDER_LIGHTING_COUNT && strcmp(argv[i],render_lighting_names[lighting])){
+				lighting++;
+			}
+			if (lighting == RENDER_LIGHTING_COUNT){
+				usage(argv[0]);
+			}
+			render_lighting = lighting;
+		} else if (!strcmp(argv[i],"-W") && i+1 < argc){
+			if (sscanf(argv[++i],"%dx%d",&width,&height) != 2 || width <= 0 || height <= 0){
+				usage(argv[0]);
+			}
+		} else if (!strcmp(argv[i],"-F") && i+1 < argc){
+			render_target_fill_ms = (float)atof(argv[++i]);
+		} else if (!strcmp(argv[i],"-L") && i+1 < argc){
+			replay_path = argv[++i];
+		} else if (!strcmp(argv[i],"-R") && i+1 < argc){
+			record_path = argv[++i];
+		} else if (!strcmp(argv[i],"-C") && i+1 < argc){
+			capture_path = argv[++i];
+		} else if (!strcmp(argv[i],"-H") && i+1 < argc){
+			hash_path = argv[++i];
+			hash_frames = true;
+		} else if (!strcmp(argv[i],"-P") && i+1 < argc){
+			trace_path = argv[++i];
+			profile_enabled = true;
+		} else if (!strcmp(argv[i],"-o") && i+1 < argc){
+			out_path = argv[++i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	scenario_t *selected[COUNT(scenarios)];
+	int selected_count = 0;
+	replay_t replay;
+	scenario_t replay_scenario = {"replay", .replay = &replay};
+	if (replay_path){
+		if (only){
+			usage(argv[0]);
+		}
+		if (!replay_load(&replay,replay_path) || !replay.tick_count){
+			fatal_error("couldn't load an input log from %s",replay_path);
+		}
+		selected[selected_count++] = &replay_scenario;
+	} else {
+		for (int i = 0; i < COUNT(scenarios); i++){
+			if (!only || !strcmp(only,scenarios[i].name)){
+				selected[selected_count++] = scenarios+i;
+			}
+		}
+	}
+	//one log per run
+	if (!selected_count || (record_path && selected_count > 1)){
+		usage(argv[0]);
+	}
+
+	FILE *out = stdout;
+	if (out_path){
+		out = fopen(out_path,"w");
+		ASSERT(out);
+	}
+
+	profile_set_thread_name("main");
+	pool_init(threads);
+	//run from the repo root. without the atlas the frames are drawn untextured
+	if (textures){
+		assets_open(0);
+		asset_t *a = assets_load_image("textures/blocks.png",false);
+		if (asset_wait(a) != ASSET_READY || !render_set_atlas(a->pixels,a->width,a->height)){
+			fprintf(stderr,"couldn't load the block atlas from %s, drawing untextured\n",a->path);
+			textures = false;
+		}
+		asset_free(a);
+		assets_close();
+	}
+	if (audio){
+		shoot_sound = mixer_tone(880.0f,220.0f,0.15f,false);
+		hum_sound = mixer_tone(110.0f,110.0f,1.0f,true);
+	}
+
+	if (capture_path){
+		if (!capture_begin(capture_path)){
+			fatal_error("couldn't capture to %s",capture_path);
+		}
+		capturing = true;
+	}
+
+	float aspect = 640.0f / 480.0f;
+	fprintf(out,"{\n");
+	fprintf(out,"\t\"threads\": %d,\n",pool_get_thread_count());
+	fprintf(out,"\t\"resolution\": [%d, %d],\n",width,height);
+	fprintf(out,"\t\"target_fill_ms\": %.3f,\n",render_target_fill_ms);
+	fprintf(out,"\t\"frames_per_tick\": %d,\n",FRAMES_PER_TICK);
+	fprintf(out,"\t\"packet_mode\": \"%s\",\n",ray_packet_mode_names[raycast_get_packet_mode()]);
+	fprintf(out,"\t\"engine\": \"%s\",\n",raycast_engine_names[raycast_engine]);
+	fprintf(out,"\t\"light_cache\": %s,\n",render_light_cache ? "true" : "false");
+	fprintf(out,"\t\"temporal\": %s,\n",render_temporal ? "true" : "false");
+	fprintf(out,"\t\"output\": \"%s\",\n",render_output_names[render_output]);
+	fprintf(out,"\t\"dither\": %s,\n",render_dither ? "true" : "false");
+	fprintf(out,"\t\"audio\": %s,\n",audio ? "true" : "false");
+	fprintf(out,"\t\"textures\": %s,\n",textures ? "true" : "false");
+	fprintf(out,"\t\"beams\": %s,\n",render_beams ? "true" : "false");
+	fprintf(out,"\t\"lighting\": \"%s\",\n",render_lighting_names[render_lighting]);
+	fprintf(out,"\t\"scenarios\": [\n");
+	for (int i = 0; i < selected_count; i++){
+		render_set_resolution(width,height);
+		run_scenario(selected[i],aspect,out,i == selected_count-1,record_path);
+	}
+	fprintf(out,"\t]");
+	int mismatch = -1;
+	if (hash_path){
+		mismatch = check_hashes(hash_path);
+		fprintf(out,",\n\t\"hashes\": {\"frames\": %d, \"status\": \"%s\", \"first_mismatch\": %d}",
+			frame_hash_count,mismatch == -2 ? "recorded" : mismatch < 0 ? "matched" : "mismatched",mismatch < 0 ? -1 : mismatch);
+		if (mismatch == -2){
+			fprintf(stderr,"wrote %d frame hashes to %s\n",frame_hash_count,hash_path);
+		} else if (mismatch >= 0){
+			fprintf(stderr,"frame %d differs from %s\n",mismatch,hash_path);
+		} else {
+			fprintf(stderr,"all %d frames match %s\n",frame_hash_count,hash_path);
+		}
+	}
+	capture_stats_t cs;
+	if (capturing){
+		capture_end();
+		capture_get_stats(&cs);
+		fprintf(out,",\n\t\"capture\": {\"frames\": %llu, \"dropped\": %llu, \"bytes\": %llu, \"failed\": %s}",
+			(unsigned long long)cs.frames,(unsigned long long)cs.dropped,(unsigned long long)cs.bytes,cs.failed ? "true" : "false");
+		fprintf(stderr,"captured %llu frames to %s, %.0f bytes a frame, %llu dropped\n",
+			(unsigned long long)cs.frames,capture_path,cs.frames ? (double)cs.bytes / cs.frames : 0.0,(unsigned long long)cs.dropped);
+	}
+	fprintf(out,"\n}\n");
+
+	if (out != stdout){
+		fclose(out);
+	}
+	if (trace_path && !profile_write_trace(trace_path)){
+		fprintf(stderr,"couldn't write %s\n",trace_path);
+		return 1;
+	}
+	if (replay_path){
+		replay_free(&replay);
+	}
+	return mismatch >= 0 || (capturing && cs.failed);
+}
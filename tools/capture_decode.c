@@ -0,0 +1,129 @@
+//turns a capture written by the game or the bench with -C back into raw frames, rgba or one
+//cga_colors index per pixel, all at the first frame's size. frames dropped while capturing are
+//filled in with the one before them, so the output keeps one frame per frame rendered.
+#include "tiny3d.h"
+#include "capture.h"
+
+static void usage(char *argv0){
+	fprintf(stderr,"usage: %s [-i] capture out.raw\n"
+		"-i writes one cga_colors index per pixel instead of rgba\n",argv0);
+	exit(1);
+}
+
+int main(int argc, char **argv){
+	bool indices = false;
+	char *paths[2];
+	int path_count = 0;
+	for (int i = 1; i < argc; i++){
+		if (!strcmp(argv[i],"-i")){
+			indices = true;
+		} else if (path_count < 2){
+			paths[path_count++] = argv[i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (path_count != 2){
+		usage(argv[0]);
+	}
+	FILE *in = fopen(paths[0],"rb");
+	if (!in){
+		fprintf(stderr,"couldn't open %s\n",paths[0]);
+		return 1;
+	}
+	capture_header_t h;
+	if (fread(&h,sizeof(h),1,in) != 1 || memcmp(h.magic,CAPTURE_MAGIC,sizeof(h.magic)) || h.version != CAPTURE_VERSION){
+		fprintf(stderr,"%s isn't a version %d capture\n",paths[0],CAPTURE_VERSION);
+		return 1;
+	}
+	FILE *out = fopen(paths[1],"wb");
+	if (!out){
+		fprintf(stderr,"couldn't open %s\n",paths[1]);
+		return 1;
+	}
+
+	uint8_t *pixels = 0, *encoded = 0;
+	int width = 0, height = 0; //the current frame's
+	int out_width = 0, out_height = 0;
+	uint8_t *scaled = 0;
+	color_t *rgba = 0;
+	int frames = 0, written = 0, keyframes = 0, resized = 0;
+	uint64_t first_time = 0, last_time = 0;
+	uint32_t next_frame = 0;
+	bool broken = false;
+	capture_frame_header_t f;
+	while (fread(&f,sizeof(f),1,in) == 1){
+		if (!f.width || !f.height || (!(f.flags & CAPTURE_KEYFRAME) && (f.width != width || f.height != height))){
+			broken = true;
+			break;
+		}
+		int count = f.width*f.height;
+		if (f.width != width || f.height != height){
+			width = f.width;
+			height = f.height;
+			pixels = realloc(pixels,count);
+			ASSERT(pixels);
+		}
+		if (f.flags & CAPTURE_KEYFRAME){
+			memset(pixels,0,count);
+			keyframes++;
+		}
+		encoded = realloc(encoded,MAX(f.size,1));
+		ASSERT(encoded);
+		if (fread(encoded,1,f.size,in) != f.size || !capture_decode(encoded,f.size,pixels,count)){
+			broken = true;
+			break;
+		}
+
+		if (!out_width){
+			out_width = width;
+			out_height = height;
+			scaled = malloc(out_width*out_height);
+			rgba = malloc(out_width*out_height*sizeof(*rgba));
+			ASSERT(scaled && rgba);
+			first_time = f.time;
+		}
+		//nearest neighbour, as render_set_resolution scales the finished frame
+		if (width != out_width || height != out_height){
+			resized++;
+		}
+		for (int y = 0; y < out_height; y++){
+			for (int x = 0; x < out_width; x++){
+				scaled[y*out_width+x] = pixels[(y*height/out_height)*width + x*width/out_width];
+			}
+		}
+		void *frame = scaled;
+		size_t size = out_width*out_height;
+		if (!indices){
+			for (int i = 0; i < out_width*out_height; i++){
+				rgba[i] = cga_colors[scaled[i] & 15];
+			}
+			frame = rgba;
+			size *= sizeof(*rgba);
+		}
+		//stands in for the frames dropped before it too
+		uint32_t copies = f.frame - next_frame + 1;
+		for (uint32_t c = 0; c < copies; c++){
+			if (fwrite(frame,size,1,out) != 1){
+				fprintf(stderr,"couldn't write %s\n",paths[1]);
+				return 1;
+			}
+		}
+		written += copies;
+		next_frame = f.frame + 1;
+		last_time = f.time;
+		frames++;
+	}
+	fclose(in);
+	if (fclose(out)){
+		fprintf(stderr,"couldn't write %s\n",paths[1]);
+		return 1;
+	}
+	if (broken){
+		fprintf(stderr,"%s is cut off or damaged after frame %d, kept what came before\n",paths[0],frames);
+	}
+	double seconds = (last_time - first_time) / 1e9;
+	fprintf(stderr,"%d frames (%d keyframes, %d dropped, %d scaled) over %.2f s, %d written at %dx%d %s\n",
+		frames,keyframes,written-frames,resized,seconds,written,out_width,out_height,indices ? "indices" : "rgba");
+	return 0;
+}
@@ -0,0 +1,32 @@
+//stand-ins for the tiny3d platform layer so the game logic can run without a window.
+#include "tiny3d.h"
+
+void error_box(char *msg){
+}
+
+void fatal_error(char *format, ...){
+	va_list args;
+	va_start(args,format);
+	vfprintf(stderr,format,args);
+	fprintf(stderr,"\n");
+	va_end(args);
+	exit(1);
+}
+
+#if _WIN32
+uint64_t get_time(void){
+	static LARGE_INTEGER freq = {0};
+	if (!freq.QuadPart){
+		QueryPerformanceFrequency(&freq);
+	}
+	LARGE_INTEGER t;
+	QueryPerformanceCounter(&t);
+	return (uint64_t)(t.QuadPart / freq.QuadPart) * 1000000000 + (uint64_t)(t.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+}
+#else
+uint64_t get_time(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+#endif
@@ -0,0 +1,170 @@
+//load test for tinycraft_server: connects players that wander the room, look around and now
+//and then shoot, all from one process, and reports the tick times the server sent along with
+//its snapshots and what the snapshots cost, as json.
+#include "tiny3d.h"
+#include "net.h"
+
+#include <poll.h>
+
+typedef struct {
+	net_client_t net;
+	keys_t keys;
+	vec2 look;
+	int turn; //ticks until the keys change
+	bool gone;
+} player_t;
+
+static int compare_u32(const void *a, const void *b){
+	uint32_t x = *(uint32_t *)a, y = *(uint32_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void wander(player_t *p){
+	if (--p->turn <= 0){
+		p->turn = 10 + rand() % 40;
+		int r = rand();
+		p->keys.forward = r & 1;
+		p->keys.backward = !(r & 1) && (r & 2);
+		p->keys.left = r & 4;
+		p->keys.right = !(r & 4) && (r & 8);
+		p->keys.jump = (r & 48) == 48;
+	}
+	p->keys.just_attacked = rand() % (30 * (int)TICK_RATE) == 0;
+	p->look[0] = LERP(p->look[0],(float)(rand() % 60 - 30),0.1f);
+	p->look[1] = fmodf(p->look[1] + (float)(rand() % 7 - 3),360.0f);
+}
+
+static void usage(char *argv0){
+	fprintf(stderr,"usage: %s [-s socket] [-n players] [-d seconds] [-o out.json]\n",argv0);
+	exit(1);
+}
+
+int main(int argc, char **argv){
+	char *path = "tinycraft.sock";
+	char *out_path = 0;
+	int count = 16;
+	double seconds = 10;
+	for (int i = 1; i < argc; i++){
+		if (!strcmp(argv[i],"-s") && i+1 < argc){
+			path = argv[++i];
+		} else if (!strcmp(argv[i],"-n") && i+1 < argc){
+			count = atoi(argv[++i]);
+		} else if (!strcmp(argv[i],"-d") && i+1 < argc){
+			seconds = atof(argv[++i]);
+		} else if (!strcmp(argv[i],"-o") && i+1 < argc){
+			out_path = argv[++i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (count < 1 || count > NET_MAX_CLIENTS){
+		usage(argv[0]);
+	}
+	srand(1);
+	player_t *players = calloc(count,sizeof(*players));
+	struct pollfd *fds = calloc(count,sizeof(*fds));
+	ASSERT(players && fds);
+	for (int i = 0; i < count; i++){
+		if (!net_client_connect(&players[i].net,path)){
+			fprintf(stderr,"couldn't connect player %d to %s\n",i,path);
+			return 1;
+		}
+		players[i].look[1] = (float)(rand() % 360);
+	}
+	//what queued up while the others connected isn't measured
+	for (int i = 0; i < count; i++){
+		net_client_poll(&players[i].net);
+		players[i].net.blocks.count = 0;
+	}
+
+	//one sample per server tick, whichever player hears of it first
+	int sample_count = 0, sample_capacity = (int)(seconds * TICK_RATE) + 64;
+	uint32_t *tick_ns = malloc(sample_capacity * sizeof(*tick_ns));
+	ASSERT(tick_ns);
+	uint32_t newest_tick = 0;
+	uint64_t snapshots = 0, bytes = 0;
+	int lost = 0;
+
+	uint64_t start = get_time(), next = start;
+	uint64_t end = start + (uint64_t)(seconds * 1e9);
+	for (uint64_t now = start; now < end; now = get_time()){
+		if (now >= next){
+			next += (uint64_t)(SEC_PER_TICK * 1e9);
+			for (int i = 0; i < count; i++){
+				player_t *p = players+i;
+				wander(p);
+				if (!p->gone && !net_client_send_input(&p->net,&p->keys,p->look)){
+					p->gone = true;
+					lost++;
+				}
+			}
+		}
+		for (int i = 0; i < count; i++){
+			fds[i] = (struct pollfd){.fd = players[i].net.socket, .events = POLLIN};
+		}
+		poll(fds,count,next > now ? (int)((next - now + 999999) / 1000000) : 0);
+		for (int i = 0; i < count; i++){
+			player_t *p = players+i;
+			if (p->gone || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR))){
+				continue;
+			}
+			uint64_t received = p->net.bytes_received;
+			int n = net_client_poll(&p->net);
+			if (n < 0){
+				p->gone = true;
+				lost++;
+				continue;
+			}
+			snapshots += n;
+			bytes += p->net.bytes_received - received;
+			p->net.blocks.count = 0; //no world to put them in
+			if (n && p->net.state.tick > newest_tick){
+				newest_tick = p->net.state.tick;
+				if (sample_count == sample_capacity){
+					sample_capacity *= 2;
+					tick_ns = realloc(tick_ns,sample_capacity * sizeof(*tick_ns));
+					ASSERT(tick_ns);
+				}
+				tick_ns[sample_count++] = p->net.server_tick_ns;
+			}
+		}
+	}
+	double elapsed = (get_time() - start) / 1e9;
+
+	//what the newest state would have cost from scratch, against what the deltas did
+	net_buffer_t full = {0};
+	net_encode_snapshot(&full,&players[0].net.state,0,0,0,0);
+
+	qsort(tick_ns,sample_count,sizeof(*tick_ns),compare_u32);
+	double mean = 0;
+	for (int i = 0; i < sample_count; i++){
+		mean += tick_ns[i];
+	}
+	mean = sample_count ? mean / sample_count / 1e6 : 0;
+	#define PERCENTILE(p) (sample_count ? tick_ns[MIN(sample_count-1,(int)(sample_count * (p)))] / 1e6 : 0.0)
+
+	FILE *out = stdout;
+	if (out_path && !(out = fopen(out_path,"w"))){
+		fprintf(stderr,"couldn't open %s\n",out_path);
+		return 1;
+	}
+	fprintf(out,"{\n");
+	fprintf(out,"\t\"players\": %d,\n",count);
+	fprintf(out,"\t\"seconds\": %.2f,\n",elapsed);
+	fprintf(out,"\t\"disconnected\": %d,\n",lost);
+	fprintf(out,"\t\"server_ticks\": %d,\n",sample_count);
+	fprintf(out,"\t\"tick_ms\": {\"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n",
+		mean,PERCENTILE(0.5),PERCENTILE(0.99),sample_count ? tick_ns[sample_count-1] / 1e6 : 0.0);
+	fprintf(out,"\t\"snapshots_per_player_per_second\": %.2f,\n",snapshots / elapsed / count);
+	fprintf(out,"\t\"bytes_per_snapshot\": %.1f,\n",snapshots ? (double)bytes / snapshots : 0.0);
+	fprintf(out,"\t\"full_snapshot_bytes\": %d,\n",full.count);
+	fprintf(out,"\t\"bytes_per_player_per_second\": %.0f\n",bytes / elapsed / count);
+	fprintf(out,"}\n");
+	if (out != stdout){
+		fclose(out);
+	}
+	for (int i = 0; i < count; i++){
+		net_client_close(&players[i].net);
+	}
+	return lost > 0;
+}
@@ -0,0 +1,141 @@
+//micro benchmark of the inline tinymath routines against the out-of-line ones in tinymath.c.
+//each case runs the same loop both ways, checks the results agree to the bit and reports json.
+#define TINYMATH_NO_REMAP
+#include "tiny3d.h"
+
+#define COUNT_VECTORS 4096
+#define REPEATS 200
+
+static vec3 in[COUNT_VECTORS], out_a[COUNT_VECTORS], out_b[COUNT_VECTORS];
+static mat4 matrix;
+
+//camera ray generation as fill does it, per pixel
+static void rays_call(void){
+	vec3 right = {0.8f,0,0.6f}, up = {0,1,0}, ray = {-0.6f,0,0.8f};
+	for (int i = 0; i < COUNT_VECTORS; i++){
+		vec3 temp;
+		vec3_scale(right,in[i][0],out_a[i]);
+		vec3_scale(up,in[i][1],temp);
+		vec3_add(out_a[i],temp,out_a[i]);
+		vec3_add(out_a[i],ray,out_a[i]);
+		vec3_scale(out_a[i],100.0f,out_a[i]);
+	}
+}
+
+static void rays_inline(void){
+	vec3 right = {0.8f,0,0.6f}, up = {0,1,0}, ray = {-0.6f,0,0.8f};
+	for (int i = 0; i < COUNT_VECTORS; i++){
+		vec3 temp;
+		tm_vec3_scale(right,in[i][0],out_b[i]);
+		tm_vec3_scale(up,in[i][1],temp);
+		tm_vec3_add(out_b[i],temp,out_b[i]);
+		tm_vec3_add(out_b[i],ray,out_b[i]);
+		tm_vec3_scale(out_b[i],100.0f,out_b[i]);
+	}
+}
+
+//the player's eye ray: two rotations per call
+static void rotate_call(void){
+	for (int i = 0; i < COUNT_VECTORS; i++){
+		vec3_rotate_deg(in[i],(vec3){1,0,0},in[i][0]*10.0f,out_a[i]);
+		vec3_rotate_deg(out_a[i],(vec3){0,1,0},in[i][1]*10.0f,out_a[i]);
+	}
+}
+
+static void rotate_inline(void){
+	for (int i = 0; i < COUNT_VECTORS; i++){
+		tm_vec3_rotate_deg(in[i],(vec3){1,0,0},in[i][0]*10.0f,out_b[i]);
+		tm_vec3_rotate_deg(out_b[i],(vec3){0,1,0},in[i][1]*10.0f,out_b[i]);
+	}
+}
+
+static void rotate_batch_call(void){
+	for (int i = 0; i < COUNT_VECTORS; i++){
+		vec3_rotate_deg(in[i],(vec3){0,1,0},37.0f,out_a[i]);
+	}
+}
+
+static void rotate_batch_inline(void){
+	tm_vec3_rotate_deg_n(COUNT_VECTORS,in,(vec3){0,1,0},37.0f,out_b);
+}
+
+static void transform_call(void){
+	for (int i = 0; i < COUNT_VECTORS; i++){
+		vec4 p;
+		mat4_mul_vec3_pos(matrix,in[i],p);
+		vec3_copy(p,out_a[i]);
+	}
+}
+
+static void transform_inline(void){
+	tm_mat4_transform_points(matrix,COUNT_VECTORS,in,out_b);
+}
+
+//normalized distance between pairs, like light falloff in shade
+static void falloff_call(void){
+	for (int i = 0; i < COUNT_VECTORS; i++){
+		vec3 d;
+		vec3_sub(in[i],in[COUNT_VECTORS-1-i],d);
+		vec3_normalize(d,d);
+		vec3_scale(d,vec3_distance(in[i],in[COUNT_VECTORS-1-i]),out_a[i]);
+	}
+}
+
+static void falloff_inline(void){
+	for (int i = 0; i < COUNT_VECTORS; i++){
+		vec3 d;
+		tm_vec3_sub(in[i],in[COUNT_VECTORS-1-i],d);
+		tm_vec3_normalize(d,d);
+		tm_vec3_scale(d,tm_vec3_distance(in[i],in[COUNT_VECTORS-1-i]),out_b[i]);
+	}
+}
+
+typedef struct {
+	char *name;
+	void (*call)(void), (*inlined)(void);
+} bench_case_t;
+
+static bench_case_t cases[] = {
+	{"rays", rays_call, rays_inline},
+	{"rotate", rotate_call, rotate_inline},
+	{"rotate_batch", rotate_batch_call, rotate_batch_inline},
+	{"transform_points", transform_call, transform_inline},
+	{"falloff", falloff_call, falloff_inline},
+};
+
+//best of REPEATS, in nanoseconds per vector
+static double measure(void (*fn)(void)){
+	uint64_t best = UINT64_MAX;
+	for (int r = 0; r < REPEATS; r++){
+		uint64_t t0 = get_time();
+		fn();
+		best = MIN(best,get_time() - t0);
+	}
+	return (double)best / COUNT_VECTORS;
+}
+
+int main(int argc, char **argv){
+	srand(1);
+	for (int i = 0; i < COUNT_VECTORS; i++){
+		for (int k = 0; k < 3; k++){
+			in[i][k] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+		}
+	}
+	mat4_identity(matrix);
+	mat4_rotate(matrix,(vec3){1,2,3},0.7f);
+	mat4_translate(matrix,(vec3){4,5,6});
+
+	bool all_exact = true;
+	printf("{\n\t\"vectors\": %d,\n\t\"cases\": [\n",COUNT_VECTORS);
+	for (int c = 0; c < COUNT(cases); c++){
+		double call = measure(cases[c].call);
+		double inlined = measure(cases[c].inlined);
+		bool exact = !memcmp(out_a,out_b,sizeof(out_a));
+		all_exact &= exact;
+		printf("\t\t{\"name\": \"%s\", \"call_ns\": %.3f, \"inline_ns\": %.3f, \"speedup\": %.2f, \"exact\": %s}%s\n",
+			cases[c].name,call,inlined,call/inlined,exact ? "true" : "false",c+1 < COUNT(cases) ? "," : "");
+		fprintf(stderr,"%-17s %7.3f ns -> %7.3f ns  %5.2fx%s\n",cases[c].name,call,inlined,call/inlined,exact ? "" : "  MISMATCH");
+	}
+	printf("\t]\n}\n");
+	return !all_exact;
+}
@@ -0,0 +1,358 @@
+//headless authoritative server for networked play, see net.h. every connected client gets a
+//player the server moves through move_player with the input it sent last, then the stored
+//entities tick once for everyone, and each client is queued a snapshot against the last one it
+//was queued. clients a tick behind the same amount share one encoding. a client whose queue is
+//full has the tick's snapshot dropped instead of the server waiting for it.
+#include "tiny3d.h"
+#include "net.h"
+#include "pool.h"
+#include "replay.h"
+
+#include <poll.h>
+#include <signal.h>
+
+#define TICK_NS ((uint64_t)(SEC_PER_TICK * 1e9))
+#define MAX_CATCH_UP 5 //ticks behind before the missed ones are dropped instead
+#define MAX_BASELINES 8 //distinct baselines encoded once per tick, others are encoded per client
+
+typedef struct {
+	int socket; //-1 for a free slot
+	bool welcomed;
+	net_buffer_t in;
+	net_buffer_t queue; //whole messages only
+	entity_t body;
+	net_input_t input;
+	uint32_t shots; //input.shots the last tick saw
+	uint32_t last_sent; //tick of the last snapshot queued, 0 for none
+	uint64_t dropped;
+} client_t;
+
+static client_t clients[NET_MAX_CLIENTS];
+static net_state_t history[NET_HISTORY];
+static uint32_t ticks;
+static net_buffer_t edits; //net_block_t, in tick order
+static int queue_limit = 256 << 10;
+static float edit_rate; //synthetic block edits per second
+static volatile sig_atomic_t quit;
+
+static struct {
+	uint64_t ticks, tick_ns, max_tick_ns;
+	uint64_t bytes, dropped, encodes;
+} stats;
+
+static void on_signal(int s){
+	quit = 1;
+}
+
+static void drop_client(client_t *c){
+	net_close(c->socket);
+	free(c->in.data);
+	free(c->queue.data);
+	memset(c,0,sizeof(*c));
+	c->socket = -1;
+}
+
+static void flush(client_t *c){
+	while (c->queue.count){
+		int n = net_send(c->socket,c->queue.data,c->queue.count);
+		if (n < 0){
+			drop_client(c);
+			return;
+		}
+		if (!n){
+			return;
+		}
+		stats.bytes += n;
+		net_buffer_consume(&c->queue,n);
+	}
+}
+
+static void welcome(client_t *c, net_hello_t *hello){
+	int id = (int)(c - clients);
+	net_welcome_t w = {NET_VERSION,(uint32_t)id};
+	net_header_t h = {NET_WELCOME,sizeof(w)};
+	net_buffer_append(&c->queue,&h,sizeof(h));
+	net_buffer_append(&c->queue,&w,sizeof(w));
+	flush(c);
+	if (c->socket == -1 || hello->version != NET_VERSION){
+		drop_client(c);
+		return;
+	}
+	c->welcomed = true;
+	c->body = (entity_t){.width = 0.6f, .height = 1.8f};
+	//spread over the room's floor, players don't collide with each other
+	entity_set_position(&c->body,4.0f + id % 12 * 2,8,4.0f + id / 12 % 12 * 2);
+}
+
+static void receive(client_t *c){
+	if (net_receive(c->socket,&c->in) < 0){
+		drop_client(c);
+		return;
+	}
+	int at = 0;
+	while (c->in.count - at >= (int)sizeof(net_header_t)){
+		net_header_t h;
+		memcpy(&h,c->in.data + at,sizeof(h));
+		if (h.size > sizeof(net_input_t) || c->in.count - at - (int)sizeof(h) < (int)h.size){
+			if (h.size > sizeof(net_input_t)){
+				drop_client(c);
+				return;
+			}
+			break;
+		}
+		uint8_t *payload = c->in.data + at + sizeof(h);
+		if (h.type == NET_HELLO && h.size == sizeof(net_hello_t) && !c->welcomed){
+			net_hello_t hello;
+			memcpy(&hello,payload,sizeof(hello));
+			welcome(c,&hello);
+			if (c->socket == -1){
+				return;
+			}
+		} else if (h.type == NET_INPUT && h.size == sizeof(net_input_t) && c->welcomed){
+			memcpy(&c->input,payload,sizeof(c->input));
+		} else {
+			drop_client(c);
+			return;
+		}
+		at += sizeof(h) + h.size;
+	}
+	net_buffer_consume(&c->in,at);
+}
+
+//the edits made after tick
+static net_block_t *edits_after(uint32_t tick, int *count){
+	net_block_t *e = (net_block_t *)edits.data;
+	int n = edits.count / (int)sizeof(net_block_t);
+	int lo = 0, hi = n;
+	while (lo < hi){
+		int mid = (lo + hi) / 2;
+		if (e[mid].tick <= tick){
+			lo = mid+1;
+		} else {
+			hi = mid;
+		}
+	}
+	*count = n - lo;
+	return e + lo;
+}
+
+//blocks flipping up under the ceiling where nobody walks, to load the edit path
+static void synthetic_edits(void){
+	static float owed;
+	owed += edit_rate / (float)TICK_RATE;
+	for (; owed >= 1.0f; owed -= 1.0f){
+		net_block_t b = {
+			.x = 1 + rand() % 30,
+			.y = 16 + rand() % 14,
+			.z = 1 + rand() % 30,
+			.tick = ticks,
+		};
+		block_t *was = get_block(b.x,b.y,b.z);
+		b.block = was && *was ? BLOCK_AIR : BLOCK_COBBLESTONE;
+		set_block(b.x,b.y,b.z,b.block);
+		net_buffer_append(&edits,&b,sizeof(b));
+	}
+	world_clear_changes(); //nothing here caches the world
+}
+
+static void server_tick(uint32_t previous_tick_ns){
+	ticks++;
+	for (int i = 0; i < NET_MAX_CLIENTS; i++){
+		client_t *c = clients+i;
+		if (!c->welcomed){
+			continue;
+		}
+		keys_t k = {
+			.left = c->input.input & REPLAY_LEFT,
+			.right = c->input.input & REPLAY_RIGHT,
+			.backward = c->input.input & REPLAY_BACKWARD,
+			.forward = c->input.input & REPLAY_FORWARD,
+			.jump = c->input.input & REPLAY_JUMP,
+			.just_attacked = c->input.shots != c->shots,
+		};
+		c->shots = c->input.shots;
+		c->body.head_rotation[0] = c->input.pitch;
+		c->body.head_rotation[1] = c->input.yaw;
+		move_player(&c->body,&k);
+	}
+	update_entities();
+	synthetic_edits();
+
+	net_state_t *state = history + ticks % NET_HISTORY;
+	state->tick = ticks;
+	for (int i = 0; i < NET_MAX_CLIENTS; i++){
+		net_state_set_player(state,i,clients[i].welcomed ? &clients[i].body : 0);
+	}
+	net_state_set_lights(state);
+
+	static net_buffer_t encoded, scratch;
+	struct {
+		uint32_t baseline;
+		int offset, size;
+	} shared[MAX_BASELINES];
+	int shared_count = 0;
+	encoded.count = 0;
+	for (int i = 0; i < NET_MAX_CLIENTS; i++){
+		client_t *c = clients+i;
+		if (!c->welcomed){
+			continue;
+		}
+		uint32_t baseline = c->last_sent && ticks - c->last_sent < NET_HISTORY ? c->last_sent : 0;
+		uint8_t *message = 0;
+		int size = 0;
+		for (int s = 0; s < shared_count && !message; s++){
+			if (shared[s].baseline == baseline){
+				message = encoded.data + shared[s].offset;
+				size = shared[s].size;
+			}
+		}
+		if (!message){
+			int edit_count;
+			net_block_t *e = edits_after(baseline,&edit_count);
+			net_buffer_t *out = shared_count < MAX_BASELINES ? &encoded : &scratch;
+			int offset = out == &scratch ? 0 : out->count;
+			out->count = offset;
+			net_encode_snapshot(out,state,baseline ? history + baseline % NET_HISTORY : 0,previous_tick_ns,e,edit_count);
+			size = out->count - offset;
+			if (out == &encoded){
+				shared[shared_count].baseline = baseline;
+				shared[shared_count].offset = offset;
+				shared[shared_count].size = size;
+				shared_count++;
+			}
+			message = out->data + offset;
+			stats.encodes++;
+		}
+		//a message bigger than the whole queue still goes into an empty one
+		if (c->queue.count && c->queue.count + size > queue_limit){
+			c->dropped++;
+			stats.dropped++;
+			continue;
+		}
+		net_buffer_append(&c->queue,message,size);
+		c->last_sent = ticks;
+	}
+	for (int i = 0; i < NET_MAX_CLIENTS; i++){
+		if (clients[i].welcomed){
+			flush(clients+i);
+		}
+	}
+}
+
+static void usage(char *argv0){
+	fprintf(stderr,"usage: %s [-s socket] [-t threads] [-q queue_kb] [-e edits_per_second] [-d seconds]\n",argv0);
+	exit(1);
+}
+
+int main(int argc, char **argv){
+	char *path = "tinycraft.sock";
+	int threads = 0;
+	double seconds = 0;
+	for (int i = 1; i < argc; i++){
+		if (!strcmp(argv[i],"-s") && i+1 < argc){
+			path = argv[++i];
+		} else if (!strcmp(argv[i],"-t") && i+1 < argc){
+			threads = atoi(argv[++i]);
+		} else if (!strcmp(argv[i],"-q") && i+1 < argc){
+			queue_limit = atoi(argv[++i]) << 10;
+		} else if (!strcmp(argv[i],"-e") && i+1 < argc){
+			edit_rate = (float)atof(argv[++i]);
+		} else if (!strcmp(argv[i],"-d") && i+1 < argc){
+			seconds = atof(argv[++i]);
+		} else {
+			usage(argv[0]);
+		}
+	}
+	signal(SIGPIPE,SIG_IGN);
+	signal(SIGINT,on_signal);
+	signal(SIGTERM,on_signal);
+	for (int i = 0; i < NET_MAX_CLIENTS; i++){
+		clients[i].socket = -1;
+	}
+
+	pool_init(threads);
+	world_open(0);
+	world_load_around((vec3){16,8,16});
+	int listener = net_listen(path);
+	if (listener == -1){
+		fprintf(stderr,"couldn't listen on %s\n",path);
+		return 1;
+	}
+	fprintf(stderr,"listening on %s\n",path);
+
+	static struct pollfd fds[NET_MAX_CLIENTS+1];
+	static int fd_clients[NET_MAX_CLIENTS+1];
+	uint64_t start = get_time(), next = start, last_report = start;
+	uint32_t tick_ns = 0;
+	while (!quit && (!seconds || get_time() - start < seconds * 1e9)){
+		int n = 0;
+		fds[n++] = (struct pollfd){.fd = listener, .events = POLLIN};
+		for (int i = 0; i < NET_MAX_CLIENTS; i++){
+			if (clients[i].socket != -1){
+				fd_clients[n] = i;
+				fds[n++] = (struct pollfd){.fd = clients[i].socket, .events = POLLIN | (clients[i].queue.count ? POLLOUT : 0)};
+			}
+		}
+		uint64_t now = get_time();
+		poll(fds,n,now < next ? (int)((next - now + 999999) / 1000000) : 0);
+		if (fds[0].revents & POLLIN){
+			int s;
+			while ((s = net_accept(listener)) != -1){
+				int free_slot = 0;
+				while (free_slot < NET_MAX_CLIENTS && clients[free_slot].socket != -1){
+					free_slot++;
+				}
+				if (free_slot == NET_MAX_CLIENTS){
+					net_close(s);
+				} else {
+					clients[free_slot].socket = s;
+				}
+			}
+		}
+		for (int f = 1; f < n; f++){
+			client_t *c = clients + fd_clients[f];
+			if (fds[f].revents & (POLLIN | POLLHUP | POLLERR)){
+				receive(c);
+			}
+			if (c->socket != -1 && (fds[f].revents & POLLOUT)){
+				flush(c);
+			}
+		}
+
+		now = get_time();
+		if (now < next){
+			continue;
+		}
+		if (now - next > MAX_CATCH_UP*TICK_NS){
+			next = now;
+		}
+		server_tick(tick_ns);
+		uint64_t done = get_time();
+		tick_ns = (uint32_t)(done - now);
+		stats.ticks++;
+		stats.tick_ns += tick_ns;
+		stats.max_tick_ns = MAX(stats.max_tick_ns,tick_ns);
+		next += TICK_NS;
+
+		if (done - last_report >= 1000000000ull){
+			int connected = 0;
+			for (int i = 0; i < NET_MAX_CLIENTS; i++){
+				connected += clients[i].welcomed;
+			}
+			double s = (done - last_report) / 1e9;
+			fprintf(stderr,"tick %u: %d clients, %d lights, tick %.3f ms mean %.3f max, %.0f KB/s out, %.1f encodes a tick, %llu dropped\n",
+				ticks,connected,light_count,stats.tick_ns / 1e6 / MAX(stats.ticks,1),stats.max_tick_ns / 1e6,stats.bytes / 1024.0 / s,
+				(double)stats.encodes / MAX(stats.ticks,1),(unsigned long long)stats.dropped);
+			memset(&stats,0,sizeof(stats));
+			last_report = done;
+		}
+	}
+	for (int i = 0; i < NET_MAX_CLIENTS; i++){
+		if (clients[i].socket != -1){
+			drop_client(clients+i);
+		}
+	}
+	net_close(listener);
+	remove(path);
+	return 0;
+}